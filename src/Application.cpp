@@ -24,16 +24,37 @@
 
 #include "Application.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include <list>
 #include <memory>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 
 #include <boost/asio/io_service.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/io/ios_state.hpp>
 
+#include "TcpChurn.hpp"
+#include "TcpListener.hpp"
 #include "TcpSession.hpp"
 #include "UdpSession.hpp"
+#include "EndpointRange.hpp"
+#include "IoUring.hpp"
+#include "ReceiveGroup.hpp"
+#include "Reporter.hpp"
+#include "PerfCounters.hpp"
+#include "Results.hpp"
+#include "Size.hpp"
+#include "Summary.hpp"
 #include "Signal.hpp"
 
 namespace enyx {
@@ -43,38 +64,107 @@ namespace {
 
 using SessionPtr = std::shared_ptr<Session>;
 
+using TcpListenerPtr = std::shared_ptr<TcpListener>;
+
+using TcpChurnPtr = std::shared_ptr<TcpChurn>;
+
+// How often the main thread checks for exit requests
+// when the reactor threads may block.
+constexpr std::chrono::milliseconds EXIT_CHECK_INTERVAL{100};
+
 SessionPtr
 _create_session(boost::asio::io_service & io_service,
-                const SessionConfiguration & configuration)
+                const SessionConfiguration & configuration,
+                std::shared_ptr<ReceiveGroup> group)
 {
     if (configuration.protocol == SessionConfiguration::TCP)
         return std::make_shared<TcpSession>(io_service, configuration);
     else
-        return std::make_shared<UdpSession>(io_service, configuration);
+        return std::make_shared<UdpSession>(io_service, configuration,
+                                            std::move(group));
 }
 
 SessionPtr
 create_session(boost::asio::io_service & io_service,
-               const SessionConfiguration & configuration)
+               const SessionConfiguration & configuration,
+               std::shared_ptr<ReceiveGroup> group = nullptr)
 {
-    auto session = _create_session(io_service, configuration);
+    auto session = _create_session(io_service, configuration,
+                                   std::move(group));
     session->initialize();
     return session;
 }
 
+// Allow the main thread to wait for the reactor threads
+// completion with a timeout.
+class Completion final
+{
+public:
+    explicit
+    Completion(std::size_t count)
+        : mutex_()
+        , condition_()
+        , remaining_count_(count)
+    { }
+
+    void
+    notify()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (-- remaining_count_ == 0)
+            condition_.notify_all();
+    }
+
+    // Return true when all the threads have completed.
+    bool
+    wait_until(std::chrono::steady_clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        return condition_.wait_until(lock, deadline,
+                                     [this] { return remaining_count_ == 0; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::size_t remaining_count_;
+};
 
 class Thread final
 {
 public:
-    Thread(boost::asio::io_service & io_service)
+    Thread(boost::asio::io_service & io_service,
+           Completion & completion,
+           const ApplicationConfiguration & configuration)
         : io_service_(io_service)
-        , thread_([this] { run(); })
+        , completion_(completion)
+        , polling_(configuration.polling)
+        , spin_duration_(configuration.spin_duration.total_nanoseconds())
+        , is_perf_counting_(configuration.perf_counters)
+        , busy_duration_()
+        , total_duration_()
+        , cpu_usage_()
+        , perf_counts_()
+        , thread_([this] { run(); completion_.notify(); })
     { }
 
     Thread(boost::asio::io_service & io_service,
+           Completion & completion,
+           const ApplicationConfiguration & configuration,
            CpuCoreId core_id)
         : io_service_(io_service)
-        , thread_([this, core_id] { run_pinned(core_id); })
+        , completion_(completion)
+        , polling_(configuration.polling)
+        , spin_duration_(configuration.spin_duration.total_nanoseconds())
+        , is_perf_counting_(configuration.perf_counters)
+        , busy_duration_()
+        , total_duration_()
+        , cpu_usage_()
+        , perf_counts_()
+        , thread_([this, core_id] {
+            run_pinned(core_id);
+            completion_.notify();
+        })
     { }
 
     Thread(const Thread &) = delete;
@@ -85,13 +175,102 @@ public:
     join()
     { thread_.join(); }
 
+    // Share of the thread lifetime spent running handlers,
+    // only valid once joined.
+    double
+    get_busy_ratio() const
+    {
+        if (total_duration_.count() == 0)
+            return 0.;
+
+        return double(busy_duration_.count()) / double(total_duration_.count());
+    }
+
+    // Only valid once joined.
+    CpuUsage const&
+    get_cpu_usage() const
+    { return cpu_usage_; }
+
+    // Empty without --perf-counters, only valid once joined.
+    PerfCounters::Counts const&
+    get_perf_counts() const
+    { return perf_counts_; }
+
 private:
+    using Clock = std::chrono::steady_clock;
+
     void
     run()
     {
+        CpuUsageMeter const cpu_usage_meter;
+        std::unique_ptr<PerfCounters> perf_counters;
+        if (is_perf_counting_)
+        {
+            perf_counters.reset(new PerfCounters);
+            perf_counters->start();
+        }
+
+        auto const start = Clock::now();
+        auto idle_start = start;
+
         // Loop until there is pending work and exit is not requested
         while (! is_exit_requested() && ! io_service_.stopped())
-            io_service_.poll_one();
+        {
+            switch (polling_)
+            {
+            default:
+            case ApplicationConfiguration::SPIN:
+                poll();
+                break;
+            case ApplicationConfiguration::BLOCK:
+                block();
+                break;
+            case ApplicationConfiguration::ADAPTIVE:
+                // Spin while handlers are ready, then block once
+                // nothing happened for the spin duration.
+                if (poll())
+                    idle_start = Clock::now();
+                else if (Clock::now() - idle_start >= spin_duration_)
+                {
+                    block();
+                    idle_start = Clock::now();
+                }
+                break;
+            }
+        }
+
+        total_duration_ = Clock::now() - start;
+        cpu_usage_ = cpu_usage_meter.get();
+        if (perf_counters)
+        {
+            perf_counts_ = perf_counters->stop();
+            // Rather than opening a second cycles counter.
+            for (auto const& count : perf_counts_.values)
+                if (std::strcmp(count.first, "cycles") == 0)
+                    cpu_usage_.cycles_count = count.second;
+        }
+    }
+
+    // Return true when a handler was run.
+    bool
+    poll()
+    {
+        auto const start = Clock::now();
+        if (! io_service_.poll_one())
+            return false;
+
+        busy_duration_ += Clock::now() - start;
+        return true;
+    }
+
+    void
+    block()
+    {
+        // Waiting for an event doesn't consume CPU, hence only the
+        // thread CPU time is accounted as busy.
+        auto const start = get_current_thread_cpu_time();
+        io_service_.run_one();
+        busy_duration_ += get_current_thread_cpu_time() - start;
     }
 
     void
@@ -103,6 +282,14 @@ private:
 
 private:
     boost::asio::io_service & io_service_;
+    Completion & completion_;
+    ApplicationConfiguration::Polling polling_;
+    std::chrono::nanoseconds spin_duration_;
+    bool is_perf_counting_;
+    std::chrono::nanoseconds busy_duration_;
+    std::chrono::nanoseconds total_duration_;
+    CpuUsage cpu_usage_;
+    PerfCounters::Counts perf_counts_;
     std::thread thread_;
 };
 
@@ -118,6 +305,43 @@ get_concurrency(CpuCoreIds const& core_ids)
     return core_ids.empty() ? 1 : core_ids.size();
 }
 
+// Print the CPU usage along the bytes transferred by the sessions
+// using that CPU, to tell whether the throughput is CPU bound.
+void
+print_cpu_usage(std::ostream & out,
+                CpuUsage const& usage,
+                std::uint64_t transferred_bytes_count)
+{
+    namespace pt = boost::posix_time;
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    auto const cpu_time = usage.user_time + usage.system_time;
+    out << "user_time: "
+        << pt::microseconds(duration_cast<microseconds>(usage.user_time).count())
+        << ", system_time: "
+        << pt::microseconds(duration_cast<microseconds>(usage.system_time).count())
+        << ", voluntary_context_switches_count: "
+        << usage.voluntary_context_switches_count
+        << ", involuntary_context_switches_count: "
+        << usage.involuntary_context_switches_count
+        << ", transferred_bytes_count: " << Size(transferred_bytes_count);
+
+    if (cpu_time.count())
+        out << ", bytes_per_cpu_second: "
+            << Size(std::uint64_t(double(transferred_bytes_count) * 1e9 /
+                                  double(cpu_time.count())));
+
+    if (usage.cycles_count && transferred_bytes_count)
+    {
+        boost::io::ios_flags_saver s(out);
+        out << ", cycles_per_byte: " << std::fixed << std::setprecision(2)
+            << double(usage.cycles_count) / double(transferred_bytes_count);
+    }
+
+    out << std::endl;
+}
+
 } // anonymous namespace
 
 namespace Application {
@@ -129,6 +353,15 @@ run(const ApplicationConfiguration & configuration)
 
     std::cout << "Starting.." << std::endl;
 
+    // Opened first to fail before running the sessions.
+    std::ofstream output_file;
+    if (configuration.output_format != ApplicationConfiguration::TEXT)
+    {
+        output_file.open(configuration.output_file);
+        if (! output_file)
+            throw std::runtime_error{"can't open --output-file"};
+    }
+
     auto const core_ids = to_cpu_core_list(configuration.cpus);
 
     IoServices io_services;
@@ -142,30 +375,207 @@ run(const ApplicationConfiguration & configuration)
 
     // Create all the sessions
     std::vector<SessionPtr> sessions;
+    std::vector<TcpListenerPtr> listeners;
+    std::vector<TcpChurnPtr> churns;
     std::size_t i = 0;
-    for (auto const& conf: configuration.session_configurations)
+    auto add_sessions = [&](const SessionConfiguration & conf)
     {
+        if (conf.workload == SessionConfiguration::CHURN)
+        {
+            auto & io_service = *io_services[i ++ % io_services.size()];
+            churns.push_back(std::make_shared<TcpChurn>(io_service, conf));
+            churns.back()->start();
+            return;
+        }
+
+        // The sessions are created as the connections are accepted.
+        if (conf.connections)
+        {
+            listeners.push_back(std::make_shared<TcpListener>(io_services,
+                                                              conf));
+            listeners.back()->start();
+            return;
+        }
+
         // Partition the sessions on the io_services using round robin
         auto & io_service = *io_services[i ++ % io_services.size()];
 
-        sessions.push_back(create_session(io_service, conf));
+        if (conf.reuse_port <= 1)
+        {
+            sessions.push_back(create_session(io_service, conf));
+            return;
+        }
+
+        // Each socket sharing the port is run by the next thread.
+        auto group = std::make_shared<ReceiveGroup>(conf.size);
+        sessions.push_back(create_session(io_service, conf, group));
+        for (std::size_t j = 1; j != conf.reuse_port; ++j)
+            sessions.push_back(create_session(
+                    *io_services[i ++ % io_services.size()], conf, group));
+    };
+
+    for (auto const& conf: configuration.session_configurations)
+    {
+        EndpointRange const endpoints{conf.endpoint};
+        if (endpoints.size() == 1)
+        {
+            add_sessions(conf);
+            continue;
+        }
+
+        // Each endpoint of the range is a distinct session.
+        sessions.reserve(sessions.size() + endpoints.size());
+        SessionConfiguration c = conf;
+        for (std::size_t j = 0, e = endpoints.size(); j != e; ++j)
+        {
+            c.endpoint = endpoints[j];
+            add_sessions(c);
+        }
     }
 
+    // Registered now to fail before starting the threads rather
+    // than during the sessions, and before the first ring rather
+    // than at the one exhausting the locked memory.
+    std::size_t buffers_size = 0;
+    for (auto & io_service : io_services)
+        if (boost::asio::has_service<IoUring>(*io_service))
+            buffers_size += boost::asio::use_service<IoUring>(*io_service)
+                    .get_buffers_size();
+    if (buffers_size)
+        IoUring::check_locked_memory(buffers_size);
+
+    for (auto & io_service : io_services)
+        if (boost::asio::has_service<IoUring>(*io_service))
+            boost::asio::use_service<IoUring>(*io_service).commit_buffers();
+
     // Create all the thread running the io_service reactor
+    Completion completion{io_services.size()};
     Threads threads;
     for (std::size_t i = 0U, e = io_services.size(); i != e; ++i)
     {
         if (i >= core_ids.size())
-            threads.emplace_back(*io_services[i]);
+            threads.emplace_back(*io_services[i], completion, configuration);
         else
-            threads.emplace_back(*io_services[i], core_ids[i]);
+            threads.emplace_back(*io_services[i], completion, configuration,
+                                 core_ids[i]);
     }
 
     std::cout << "Started." << std::endl;
 
+    bool const is_reporting = ! configuration.report_interval.is_special();
+    bool const is_blocking = configuration.polling != ApplicationConfiguration::SPIN;
+    if (is_reporting || is_blocking)
+    {
+        // Report from the main thread until the reactor threads complete.
+        // As blocked reactor threads don't notice exit requests, the main
+        // thread also checks them and stops the io_services.
+        Reporter reporter{sessions, listeners, std::cout};
+        std::chrono::microseconds const report_interval{
+                is_reporting ? configuration.report_interval.total_microseconds()
+                             : 0};
+        auto const now = std::chrono::steady_clock::now();
+        auto next_report = std::chrono::steady_clock::time_point::max();
+        if (is_reporting)
+            next_report = now + report_interval;
+        auto next_exit_check = std::chrono::steady_clock::time_point::max();
+        if (is_blocking)
+            next_exit_check = now + EXIT_CHECK_INTERVAL;
+
+        while (! completion.wait_until(std::min(next_report, next_exit_check)))
+        {
+            auto const now = std::chrono::steady_clock::now();
+            if (now >= next_report)
+            {
+                reporter.report();
+                next_report += report_interval;
+            }
+
+            if (now >= next_exit_check)
+            {
+                if (is_exit_requested())
+                    for (auto & io_service : io_services)
+                        io_service->stop();
+                next_exit_check = now + EXIT_CHECK_INTERVAL;
+            }
+        }
+    }
+
     for (auto & thread : threads)
         thread.join();
 
+    // Each session is run by the thread of its io_service.
+    auto const get_thread_index = [&](const boost::asio::io_service & s)
+    {
+        std::size_t thread_index = 0;
+        while (io_services[thread_index].get() != &s)
+            ++ thread_index;
+        return thread_index;
+    };
+
+    std::vector<std::uint64_t> transferred_bytes_counts(io_services.size());
+    auto const add_transferred_bytes = [&](const Session & session)
+    {
+        auto const& statistics = session.get_statistics();
+        transferred_bytes_counts[get_thread_index(session.get_io_service())] +=
+                statistics.sent_bytes_count + statistics.received_bytes_count;
+    };
+    for (auto & session : sessions)
+        add_transferred_bytes(*session);
+    for (auto & listener : listeners)
+        for (auto & session : listener->get_sessions())
+            add_transferred_bytes(*session);
+    for (auto & churn : churns)
+        transferred_bytes_counts[get_thread_index(churn->get_io_service())] +=
+                churn->get_statistics().sent_bytes_count +
+                churn->get_statistics().received_bytes_count;
+
+    std::size_t thread_index = 0;
+    CpuUsage total_cpu_usage{};
+    std::uint64_t total_transferred_bytes_count = 0;
+    for (auto const& thread : threads)
+    {
+        std::ostringstream ratio;
+        ratio << std::fixed << std::setprecision(1)
+              << thread.get_busy_ratio() * 100.;
+        std::cout << "thread " << thread_index
+                  << " busy_ratio: " << ratio.str() << "%, ";
+        print_cpu_usage(std::cout, thread.get_cpu_usage(),
+                        transferred_bytes_counts[thread_index]);
+
+        if (configuration.perf_counters)
+        {
+            std::cout << "thread " << thread_index << " perf_counters: ";
+            auto const& counts = thread.get_perf_counts();
+            auto const& values = counts.values;
+            if (values.empty())
+                std::cout << "unavailable";
+            for (auto it = values.begin(); it != values.end(); ++it)
+                std::cout << (it == values.begin() ? "" : ", ")
+                          << it->first << ": " << it->second;
+            // The PMU multiplexed the events with others.
+            if (! values.empty() && counts.running_ratio < 1.)
+            {
+                std::ostringstream ratio;
+                ratio << std::fixed << std::setprecision(1)
+                      << counts.running_ratio * 100.;
+                std::cout << ", running_ratio: "
+                          << ratio.str() << "% (scaled)";
+            }
+            std::cout << std::endl;
+        }
+
+        total_cpu_usage += thread.get_cpu_usage();
+        total_transferred_bytes_count += transferred_bytes_counts[thread_index];
+        ++ thread_index;
+    }
+
+    if (threads.size() > 1)
+    {
+        std::cout << "threads ";
+        print_cpu_usage(std::cout, total_cpu_usage,
+                        total_transferred_bytes_count);
+    }
+
     boost::system::error_code first_failure;
     for (auto & session : sessions) {
         boost::system::error_code failure = session->finalize();
@@ -173,6 +583,82 @@ run(const ApplicationConfiguration & configuration)
             first_failure = failure;
     }
 
+    for (auto & listener : listeners) {
+        boost::system::error_code failure = listener->finalize();
+        if (failure && ! first_failure)
+            first_failure = failure;
+    }
+
+    for (auto & churn : churns) {
+        boost::system::error_code failure = churn->finalize();
+        if (failure && ! first_failure)
+            first_failure = failure;
+    }
+
+    Summary summary{io_services.size(),
+                    configuration.slowest_sessions_count};
+    auto add_to_summary = [&](const Session & session)
+    {
+        summary.add(session.get_configuration(),
+                    get_thread_index(session.get_io_service()),
+                    session.get_statistics());
+    };
+    for (auto & session : sessions)
+        add_to_summary(*session);
+    for (auto & listener : listeners)
+        for (auto & session : listener->get_sessions())
+            add_to_summary(*session);
+
+    if (summary.size() > 1)
+        std::cout << summary << std::endl;
+
+    if (output_file.is_open())
+    {
+        Results results;
+        Statistics total{};
+        for (auto & session : sessions)
+        {
+            results.add("session", session->get_configuration().endpoint,
+                        session->get_failure())
+                   .add(session->get_statistics());
+            accumulate(total, session->get_statistics());
+        }
+
+        for (auto & listener : listeners)
+            listener->add_results(results, total);
+
+        for (auto & churn : churns)
+            churn->add_results(results, total);
+
+        thread_index = 0;
+        for (auto const& thread : threads)
+        {
+            auto const& usage = thread.get_cpu_usage();
+            auto & record = results.add("thread", "", {});
+            record.add("thread", std::uint64_t(thread_index));
+            record.add("user_time", std::uint64_t(usage.user_time.count()));
+            record.add("system_time", std::uint64_t(usage.system_time.count()));
+            record.add("voluntary_context_switches_count",
+                       usage.voluntary_context_switches_count);
+            record.add("involuntary_context_switches_count",
+                       usage.involuntary_context_switches_count);
+            record.add("cycles_count", usage.cycles_count);
+            record.add("transferred_bytes_count",
+                       transferred_bytes_counts[thread_index]);
+            auto const& counts = thread.get_perf_counts();
+            for (auto const& count : counts.values)
+                record.add(count.first, count.second);
+            if (! counts.values.empty())
+                record.add("perf_running_ratio", counts.running_ratio);
+            ++ thread_index;
+        }
+
+        results.add("total", "", first_failure).add(total);
+        if (summary.size() > 1)
+            summary.add_results(results);
+        results.write(output_file, configuration.output_format);
+    }
+
     if (first_failure)
         throw boost::system::system_error(first_failure);
 
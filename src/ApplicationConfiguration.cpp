@@ -0,0 +1,123 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "ApplicationConfiguration.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace enyx {
+namespace net_tester {
+
+std::istream &
+operator>>(std::istream & in, ApplicationConfiguration::Polling & polling)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        if (s == "spin")
+            polling = ApplicationConfiguration::SPIN;
+        else if (s == "adaptive")
+            polling = ApplicationConfiguration::ADAPTIVE;
+        else if (s == "block")
+            polling = ApplicationConfiguration::BLOCK;
+        else
+            throw std::runtime_error("Unexpected polling");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const ApplicationConfiguration::Polling & polling)
+{
+    std::ostream::sentry sentry(out);
+
+    if (! sentry)
+        return out;
+
+    switch (polling)
+    {
+    default:
+    case ApplicationConfiguration::SPIN:
+        return out << "spin";
+    case ApplicationConfiguration::ADAPTIVE:
+        return out << "adaptive";
+    case ApplicationConfiguration::BLOCK:
+        return out << "block";
+    }
+}
+
+std::istream &
+operator>>(std::istream & in, ApplicationConfiguration::OutputFormat & format)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        if (s == "text")
+            format = ApplicationConfiguration::TEXT;
+        else if (s == "json")
+            format = ApplicationConfiguration::JSON;
+        else if (s == "csv")
+            format = ApplicationConfiguration::CSV;
+        else
+            throw std::runtime_error("Unexpected output format");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out,
+           const ApplicationConfiguration::OutputFormat & format)
+{
+    std::ostream::sentry sentry(out);
+
+    if (! sentry)
+        return out;
+
+    switch (format)
+    {
+    default:
+    case ApplicationConfiguration::TEXT:
+        return out << "text";
+    case ApplicationConfiguration::JSON:
+        return out << "json";
+    case ApplicationConfiguration::CSV:
+        return out << "csv";
+    }
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -24,7 +24,12 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "SessionConfiguration.hpp"
 #include "Cpu.hpp"
@@ -34,9 +39,32 @@ namespace net_tester {
 
 struct ApplicationConfiguration
 {
+    enum Polling { SPIN, ADAPTIVE, BLOCK };
+    enum OutputFormat { TEXT, JSON, CSV };
+
     CpuCoreIdRanges cpus;
+    Polling polling;
+    boost::posix_time::time_duration spin_duration;
+    boost::posix_time::time_duration report_interval;
+    OutputFormat output_format;
+    std::string output_file;
+    std::size_t slowest_sessions_count;
+    bool perf_counters;
     SessionConfigurations session_configurations;
 };
 
+std::istream &
+operator>>(std::istream & in, ApplicationConfiguration::Polling & polling);
+
+std::ostream &
+operator<<(std::ostream & out, const ApplicationConfiguration::Polling & polling);
+
+std::istream &
+operator>>(std::istream & in, ApplicationConfiguration::OutputFormat & format);
+
+std::ostream &
+operator<<(std::ostream & out,
+           const ApplicationConfiguration::OutputFormat & format);
+
 } // namespace net_tester
 } // namespace enyx
@@ -0,0 +1,226 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "BandwidthSchedule.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+[[noreturn]] void
+throw_unexpected_point(const std::string & point)
+{
+    std::ostringstream error;
+    error << "Unexpected bandwidth schedule point '" << point << "'";
+    throw std::runtime_error(error.str());
+}
+
+void
+parse_point(BandwidthSchedule & schedule,
+            const std::string & point,
+            char separator)
+{
+    std::string::size_type const i = point.find(separator);
+    if (i == std::string::npos)
+        throw_unexpected_point(point);
+
+    // Both the time and the bandwidth must be entirely consumed.
+    double time;
+    std::size_t end;
+    try
+    {
+        time = std::stod(point.substr(0, i), &end);
+    }
+    catch (const std::logic_error &)
+    {
+        throw_unexpected_point(point);
+    }
+    if (end != i)
+        throw_unexpected_point(point);
+
+    Size bandwidth;
+    try
+    {
+        std::istringstream in{point.substr(i + 1)};
+        if (! (in >> bandwidth) || ! (in >> std::ws).eof())
+            throw_unexpected_point(point);
+    }
+    catch (const std::runtime_error &)
+    {
+        throw_unexpected_point(point);
+    }
+
+    schedule.add(time, bandwidth);
+}
+
+void
+parse_file(BandwidthSchedule & schedule, const std::string & path)
+{
+    std::ifstream in{path};
+    if (! in)
+    {
+        std::ostringstream error;
+        error << "can't open schedule file '" << path << "'";
+        throw std::runtime_error(error.str());
+    }
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line.erase(std::remove_if(line.begin(), line.end(),
+                                  [](char c) {
+                                      return std::isspace(
+                                              static_cast<unsigned char>(c));
+                                  }),
+                   line.end());
+        if (! line.empty() && line[0] != '#')
+            parse_point(schedule, line, ',');
+    }
+}
+
+} // anonymous namespace
+
+double
+BandwidthSchedule::get_bandwidth(double elapsed) const
+{
+    auto next = std::upper_bound(points_.begin(), points_.end(), elapsed,
+            [](double time, const Point & p) { return time < p.time; });
+
+    if (next == points_.begin())
+        return double(next->bandwidth);
+    if (next == points_.end())
+        return double(points_.back().bandwidth);
+
+    auto const& previous = *(next - 1);
+    double const ratio = (elapsed - previous.time) /
+                         (next->time - previous.time);
+    return double(previous.bandwidth) +
+           ratio * (double(next->bandwidth) - double(previous.bandwidth));
+}
+
+double
+BandwidthSchedule::estimate_duration(std::uint64_t bytes_count) const
+{
+    double remaining = double(bytes_count);
+
+    // The first bandwidth applies from the transfer start.
+    double time = 0.;
+    double bandwidth = double(points_.front().bandwidth);
+    for (auto const& p : points_)
+    {
+        if (p.time <= time)
+        {
+            bandwidth = double(p.bandwidth);
+            continue;
+        }
+
+        // Within the segment, conservatively assume its lowest bandwidth.
+        double const duration = p.time - time,
+                     lowest = std::min(bandwidth, double(p.bandwidth)),
+                     sent = (bandwidth + double(p.bandwidth)) / 2 * duration;
+        if (sent >= remaining)
+            return lowest ? time + remaining / lowest : p.time;
+
+        remaining -= sent;
+        time = p.time;
+        bandwidth = double(p.bandwidth);
+    }
+
+    if (! bandwidth)
+        return std::numeric_limits<double>::infinity();
+
+    return time + remaining / bandwidth;
+}
+
+void
+BandwidthSchedule::add(double time, Size bandwidth)
+{
+    if (time < 0 || (! points_.empty() && time < points_.back().time))
+    {
+        std::ostringstream error;
+        error << "schedule time " << time << " isn't increasing";
+        throw std::runtime_error(error.str());
+    }
+
+    points_.push_back(Point{time, bandwidth});
+}
+
+std::istream &
+operator>>(std::istream & in, BandwidthSchedule & schedule)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        schedule = BandwidthSchedule{};
+        if (! s.empty() && s[0] == '@')
+            parse_file(schedule, s.substr(1));
+        else
+        {
+            std::istringstream points{s};
+            std::string point;
+            while (std::getline(points, point, ','))
+                parse_point(schedule, point, ':');
+        }
+
+        if (schedule.empty())
+            throw std::runtime_error("empty schedule");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const BandwidthSchedule & schedule)
+{
+    std::ostream::sentry sentry(out);
+
+    if (sentry)
+    {
+        char const* separator = "";
+        for (auto const& p : schedule.points())
+        {
+            out << separator << p.time << "s:" << p.bandwidth << "/s";
+            separator = ",";
+        }
+    }
+
+    return out;
+}
+
+} // namespace net_tester
+} // namespace enyx
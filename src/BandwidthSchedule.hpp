@@ -0,0 +1,83 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "Size.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+// Bandwidth changing over the transfer, as (time, bandwidth) points
+// linearly interpolated: two points at the same time form a step,
+// two points of the same bandwidth a plateau. The bandwidth before
+// the first point and after the last one are theirs.
+//
+// The points are written inline, e.g. "0:10MB,30:1GB,30:100MB,60:100MB",
+// or read from a CSV file of "seconds,bandwidth" lines, e.g. "@ramp.csv".
+class BandwidthSchedule
+{
+public:
+    struct Point
+    {
+        double time;
+        Size bandwidth;
+    };
+
+public:
+    bool
+    empty() const
+    { return points_.empty(); }
+
+    const std::vector<Point> &
+    points() const
+    { return points_; }
+
+    // Bytes per second elapsed seconds after the transfer start.
+    double
+    get_bandwidth(double elapsed) const;
+
+    // Seconds required to transfer bytes_count.
+    double
+    estimate_duration(std::uint64_t bytes_count) const;
+
+    void
+    add(double time, Size bandwidth);
+
+private:
+    std::vector<Point> points_;
+};
+
+std::istream &
+operator>>(std::istream & in, BandwidthSchedule & schedule);
+
+std::ostream &
+operator<<(std::ostream & out, const BandwidthSchedule & schedule);
+
+} // namespace net_tester
+} // namespace enyx
@@ -1,5 +1,6 @@
 #include "BandwidthThrottle.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 namespace enyx {
@@ -7,19 +8,194 @@ namespace net_tester {
 
 BandwidthThrottle::BandwidthThrottle(boost::asio::io_service & io_service,
                                      std::size_t bandwidth,
-                                     std::size_t sampling_frequency)
+                                     std::size_t sampling_frequency,
+                                     std::size_t burst)
         : timer_(io_service),
           handler_memory_(),
           slice_bytes_count_(to_slice_bytes_count(bandwidth,
                                                   sampling_frequency)),
+          slice_remainder_(bandwidth % sampling_frequency),
+          sampling_frequency_(sampling_frequency),
+          remainder_(),
           slice_duration_(to_slice_duration(sampling_frequency)),
-          next_slice_start_(std::chrono::steady_clock::now())
+          next_slice_start_(std::chrono::steady_clock::now()),
+          bandwidth_(double(bandwidth)),
+          // The bucket holds at least a slice.
+          burst_(burst ? double(std::max(burst, slice_bytes_count_)) : 0.),
+          credit_(),
+          last_refill_(next_slice_start_),
+          is_disabled_(),
+          arrival_(SessionConfiguration::UNIFORM),
+          arrival_burst_(),
+          arrival_gap_(),
+          burst_remaining_(),
+          random_generator_(std::random_device{}()),
+          intervals_(1.),
+          burst_start_(),
+          burst_bytes_count_(),
+          burst_sizes_(),
+          burst_intervals_(),
+          schedule_(),
+          scheduled_bandwidth_(),
+          schedule_start_()
 { }
 
 void
 BandwidthThrottle::reset()
 {
     next_slice_start_ = std::chrono::steady_clock::now();
+    last_refill_ = next_slice_start_;
+    credit_ = 0.;
+    remainder_ = 0;
+    burst_remaining_ = 0;
+    schedule_start_ = next_slice_start_;
+}
+
+void
+BandwidthThrottle::set_schedule(const BandwidthSchedule & schedule,
+                                Counter & bandwidth)
+{
+    schedule_ = schedule;
+    scheduled_bandwidth_ = &bandwidth;
+}
+
+void
+BandwidthThrottle::set_arrival(SessionConfiguration::Arrival arrival,
+                               std::size_t burst_bytes_count,
+                               std::chrono::steady_clock::duration gap)
+{
+    arrival_ = arrival;
+    arrival_burst_ = burst_bytes_count;
+    arrival_gap_ = gap;
+
+    burst_sizes_.initialize();
+    burst_intervals_.initialize();
+}
+
+void
+BandwidthThrottle::get_bursts(Histogram & sizes, Histogram & intervals) const
+{
+    sizes = burst_sizes_;
+    intervals = burst_intervals_;
+    if (burst_bytes_count_)
+        sizes.record(burst_bytes_count_);
+}
+
+std::size_t
+BandwidthThrottle::next_slice()
+{
+    if (arrival_ != SessionConfiguration::UNIFORM)
+        return next_arrival();
+
+    if (! schedule_.empty())
+        return next_scheduled_slice();
+
+    if (! burst_)
+    {
+        next_slice_start_ += slice_duration_;
+        return next_slice_bytes_count();
+    }
+
+    auto const now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> const elapsed = now - last_refill_;
+    last_refill_ = now;
+    next_slice_start_ = now + slice_duration_;
+
+    // The fractional bytes are kept for the next slices.
+    credit_ = std::min(credit_ + bandwidth_ * elapsed.count(), burst_);
+    auto const bytes_count = std::size_t(credit_);
+    credit_ -= double(bytes_count);
+
+    return bytes_count;
+}
+
+std::size_t
+BandwidthThrottle::next_slice_bytes_count()
+{
+    remainder_ += slice_remainder_;
+    if (remainder_ < sampling_frequency_)
+        return slice_bytes_count_;
+
+    remainder_ -= sampling_frequency_;
+    return slice_bytes_count_ + 1;
+}
+
+std::size_t
+BandwidthThrottle::next_arrival()
+{
+    std::size_t bytes_count;
+    bool is_burst_start = true;
+
+    switch (arrival_)
+    {
+    default:
+    case SessionConfiguration::ON_OFF:
+        // The burst is sent at the bandwidth, then stays idle.
+        is_burst_start = burst_remaining_ == 0;
+        if (is_burst_start)
+            burst_remaining_ = arrival_burst_;
+
+        bytes_count = std::min(next_slice_bytes_count(), burst_remaining_);
+        burst_remaining_ -= bytes_count;
+
+        next_slice_start_ += slice_duration_;
+        if (! burst_remaining_)
+            next_slice_start_ += arrival_gap_;
+        break;
+    case SessionConfiguration::POISSON:
+        bytes_count = next_slice_bytes_count();
+        next_slice_start_ +=
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        slice_duration_ * intervals_(random_generator_));
+        break;
+    case SessionConfiguration::MICROBURST:
+        bytes_count = arrival_burst_;
+        next_slice_start_ += arrival_gap_;
+        break;
+    }
+
+    record_burst(is_burst_start, bytes_count);
+
+    return bytes_count;
+}
+
+std::size_t
+BandwidthThrottle::next_scheduled_slice()
+{
+    std::chrono::duration<double> const elapsed = next_slice_start_ -
+                                                  schedule_start_,
+                                        slice = slice_duration_;
+    double const bandwidth = schedule_.get_bandwidth(elapsed.count());
+    *scheduled_bandwidth_ = std::uint64_t(bandwidth);
+    next_slice_start_ += slice_duration_;
+
+    // The fractional bytes are kept for the next slices.
+    credit_ += bandwidth * slice.count();
+    auto const bytes_count = std::size_t(credit_);
+    credit_ -= double(bytes_count);
+
+    return bytes_count;
+}
+
+void
+BandwidthThrottle::record_burst(bool is_burst_start, std::size_t bytes_count)
+{
+    if (is_burst_start)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        if (burst_start_ != std::chrono::steady_clock::time_point{})
+        {
+            burst_sizes_.record(burst_bytes_count_);
+            burst_intervals_.record(std::uint64_t(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            now - burst_start_).count()));
+        }
+
+        burst_start_ = now;
+        burst_bytes_count_ = 0;
+    }
+
+    burst_bytes_count_ += bytes_count;
 }
 
 std::chrono::steady_clock::duration
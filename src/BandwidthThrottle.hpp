@@ -1,36 +1,54 @@
 #pragma once
 
 #include <chrono>
+#include <limits>
+#include <random>
 
 #include <boost/bind.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include "BandwidthSchedule.hpp"
+#include "Counter.hpp"
 #include "HandlerAllocator.hpp"
+#include "Histogram.hpp"
+#include "SessionConfiguration.hpp"
 
 namespace enyx {
 namespace net_tester {
 
+// Gives out the bytes count (or the datagrams count with --tx-rate)
+// allowed each slice.
+//
+// With a burst, the throttle is a token bucket: the credit accrues
+// with the elapsed time, up to the burst, hence a late slice is
+// caught up by the next ones.
+//
+// The slices may also follow a bursty arrival profile, the bursts
+// given out being recorded.
 class BandwidthThrottle
 {
 public:
     BandwidthThrottle(boost::asio::io_service & io_service,
                       std::size_t bandwidth,
-                      std::size_t sampling_frequency);
+                      std::size_t sampling_frequency,
+                      std::size_t burst = 0);
 
     template<typename Functor>
     void
     delay(Functor && f)
     {
+        if (is_disabled_)
+            return f(std::numeric_limits<std::size_t>::max());
+
         timer_.expires_at(next_slice_start_);
 
         auto handler = [this, f](boost::system::error_code const& failure) {
             if (failure)
                 return;
 
-            next_slice_start_ += slice_duration_;
-            f(slice_bytes_count_);
+            f(next_slice());
         };
 
         timer_.async_wait(make_handler(handler_memory_,
@@ -40,7 +58,43 @@ public:
     void
     reset();
 
+    // The bandwidth is limited elsewhere (e.g. by the kernel),
+    // hence the whole transfer is a single slice.
+    void
+    disable()
+    { is_disabled_ = true; }
+
+    void
+    set_arrival(SessionConfiguration::Arrival arrival,
+                std::size_t burst_bytes_count,
+                std::chrono::steady_clock::duration gap);
+
+    // The bandwidth follows the schedule from the reset(), and
+    // each slice bandwidth is stored into bandwidth.
+    void
+    set_schedule(const BandwidthSchedule & schedule, Counter & bandwidth);
+
+    // The bytes count of the bursts given out so far (including the
+    // current one) and the intervals between their starts.
+    void
+    get_bursts(Histogram & sizes, Histogram & intervals) const;
+
 private:
+    std::size_t
+    next_slice();
+
+    std::size_t
+    next_slice_bytes_count();
+
+    std::size_t
+    next_arrival();
+
+    std::size_t
+    next_scheduled_slice();
+
+    void
+    record_burst(bool is_burst_start, std::size_t bytes_count);
+
     static std::chrono::steady_clock::duration
     to_slice_duration(std::size_t sampling_frequency);
 
@@ -53,8 +107,30 @@ private:
     boost::asio::steady_timer timer_;
     HandlerMemory handler_memory_;
     std::size_t slice_bytes_count_;
+    // The bandwidth division remainder is spread over the slices.
+    std::size_t slice_remainder_;
+    std::size_t sampling_frequency_;
+    std::size_t remainder_;
     std::chrono::steady_clock::duration slice_duration_;
     std::chrono::steady_clock::time_point next_slice_start_;
+    double bandwidth_;
+    double burst_;
+    double credit_;
+    std::chrono::steady_clock::time_point last_refill_;
+    bool is_disabled_;
+    SessionConfiguration::Arrival arrival_;
+    std::size_t arrival_burst_;
+    std::chrono::steady_clock::duration arrival_gap_;
+    std::size_t burst_remaining_;
+    std::mt19937 random_generator_;
+    std::exponential_distribution<double> intervals_;
+    std::chrono::steady_clock::time_point burst_start_;
+    std::size_t burst_bytes_count_;
+    Histogram burst_sizes_;
+    Histogram burst_intervals_;
+    BandwidthSchedule schedule_;
+    Counter * scheduled_bandwidth_;
+    std::chrono::steady_clock::time_point schedule_start_;
 };
 
 } // namespace net_tester
@@ -0,0 +1,86 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace enyx {
+namespace net_tester {
+
+// Counter written by the session thread only, which can be read
+// concurrently by the reporting thread.
+//
+// As there's a single writer, increments are performed as a relaxed
+// load followed by a relaxed store, which compile to plain instructions
+// without any lock prefix or memory barrier.
+class Counter
+{
+public:
+    Counter(std::uint64_t value = 0ULL) noexcept
+        : value_(value)
+    { }
+
+    Counter(const Counter & other) noexcept
+        : value_(other.load())
+    { }
+
+    Counter &
+    operator=(const Counter & other) noexcept
+    {
+        store(other.load());
+        return *this;
+    }
+
+    operator std::uint64_t() const noexcept
+    { return load(); }
+
+    Counter &
+    operator+=(std::uint64_t value) noexcept
+    {
+        store(load() + value);
+        return *this;
+    }
+
+    Counter &
+    operator++() noexcept
+    { return *this += 1; }
+
+    std::uint64_t
+    load() const noexcept
+    { return value_.load(std::memory_order_relaxed); }
+
+private:
+    void
+    store(std::uint64_t value) noexcept
+    { value_.store(value, std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> value_;
+};
+
+} // namespace net_tester
+} // namespace enyx
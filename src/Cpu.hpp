@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <vector>
 
@@ -47,5 +48,57 @@ to_cpu_core_list(CpuCoreIdRanges const& cpu_core_id_ranges)
 void
 pin_current_thread_to_cpu_core(CpuCoreId id);
 
+// CPU time consumed by the calling thread, in user and kernel mode.
+std::chrono::nanoseconds
+get_current_thread_cpu_time();
+
+// Resources consumed by a thread.
+struct CpuUsage
+{
+    std::chrono::nanoseconds user_time;
+    std::chrono::nanoseconds system_time;
+    std::uint64_t voluntary_context_switches_count;
+    std::uint64_t involuntary_context_switches_count;
+    // 0 when the CPU cycles are not counted, on Unix they're
+    // the --perf-counters ones.
+    std::uint64_t cycles_count;
+};
+
+inline CpuUsage &
+operator+=(CpuUsage & total, CpuUsage const& usage)
+{
+    total.user_time += usage.user_time;
+    total.system_time += usage.system_time;
+    total.voluntary_context_switches_count +=
+            usage.voluntary_context_switches_count;
+    total.involuntary_context_switches_count +=
+            usage.involuntary_context_switches_count;
+    total.cycles_count += usage.cycles_count;
+    return total;
+}
+
+// Measure the resources consumed by the calling thread since the
+// meter construction, hence it must only be used by that thread.
+class CpuUsageMeter
+{
+public:
+    CpuUsageMeter();
+
+    CpuUsageMeter(const CpuUsageMeter &) = delete;
+
+    CpuUsageMeter &
+    operator=(const CpuUsageMeter &) = delete;
+
+    CpuUsage
+    get() const;
+
+private:
+    CpuUsage
+    sample() const;
+
+private:
+    CpuUsage start_;
+};
+
 } // namespace net_tester
 } // namespace enyx
@@ -25,7 +25,10 @@
 #include "Cpu.hpp"
 
 #include <pthread.h>
+#include <sys/resource.h>
+#include <time.h>
 
+#include <cerrno>
 #include <thread>
 #include <system_error>
 
@@ -44,5 +47,62 @@ pin_current_thread_to_cpu_core(CpuCoreId id)
         throw std::system_error{failure, std::generic_category()};
 }
 
+std::chrono::nanoseconds
+get_current_thread_cpu_time()
+{
+    timespec now;
+    if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) < 0)
+        throw std::system_error{errno, std::generic_category()};
+
+    return std::chrono::seconds{now.tv_sec} +
+           std::chrono::nanoseconds{now.tv_nsec};
+}
+
+namespace {
+
+std::chrono::nanoseconds
+to_duration(const timeval & time)
+{
+    return std::chrono::seconds{time.tv_sec} +
+           std::chrono::microseconds{time.tv_usec};
+}
+
+} // anonymous namespace
+
+// The cycles aren't counted here, see PerfCounters.
+CpuUsageMeter::CpuUsageMeter()
+    : start_(sample())
+{
+}
+
+CpuUsage
+CpuUsageMeter::get() const
+{
+    CpuUsage const end = sample();
+    return CpuUsage{
+        end.user_time - start_.user_time,
+        end.system_time - start_.system_time,
+        end.voluntary_context_switches_count -
+                start_.voluntary_context_switches_count,
+        end.involuntary_context_switches_count -
+                start_.involuntary_context_switches_count,
+        0};
+}
+
+CpuUsage
+CpuUsageMeter::sample() const
+{
+    rusage usage;
+    if (::getrusage(RUSAGE_THREAD, &usage) < 0)
+        throw std::system_error{errno, std::generic_category()};
+
+    return CpuUsage{
+        to_duration(usage.ru_utime),
+        to_duration(usage.ru_stime),
+        std::uint64_t(usage.ru_nvcsw),
+        std::uint64_t(usage.ru_nivcsw),
+        0};
+}
+
 } // namespace net_tester
 } // namespace enyx
@@ -41,5 +41,59 @@ pin_current_thread_to_cpu_core(CpuCoreId id)
         throw std::system_error{int(GetLastError()), std::system_category()};
 }
 
+std::chrono::nanoseconds
+get_current_thread_cpu_time()
+{
+    FILETIME creation, exit, kernel, user;
+    if (! GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        throw std::system_error{int(GetLastError()), std::system_category()};
+
+    // FILETIME counts 100ns intervals.
+    auto to_ticks = [](const FILETIME & time) {
+        return (std::uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+
+    return std::chrono::nanoseconds{(to_ticks(kernel) + to_ticks(user)) * 100};
+}
+
+// Windows doesn't account the thread context switches.
+CpuUsageMeter::CpuUsageMeter()
+    : start_(sample())
+{
+}
+
+CpuUsage
+CpuUsageMeter::get() const
+{
+    CpuUsage const end = sample();
+    return CpuUsage{
+        end.user_time - start_.user_time,
+        end.system_time - start_.system_time,
+        0,
+        0,
+        end.cycles_count - start_.cycles_count};
+}
+
+CpuUsage
+CpuUsageMeter::sample() const
+{
+    FILETIME creation, exit, kernel, user;
+    if (! GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        throw std::system_error{int(GetLastError()), std::system_category()};
+
+    auto to_duration = [](const FILETIME & time) {
+        return std::chrono::nanoseconds{
+            ((std::uint64_t(time.dwHighDateTime) << 32) |
+             time.dwLowDateTime) * 100};
+    };
+
+    ULONG64 cycles_count = 0;
+    if (! QueryThreadCycleTime(GetCurrentThread(), &cycles_count))
+        cycles_count = 0;
+
+    return CpuUsage{to_duration(user), to_duration(kernel), 0, 0,
+                    std::uint64_t(cycles_count)};
+}
+
 } // namespace net_tester
 } // namespace enyx
@@ -0,0 +1,107 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EndpointRange.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/regex.hpp>
+
+namespace enyx {
+namespace net_tester {
+
+constexpr std::size_t EndpointRange::MAX_SIZE;
+
+EndpointRange::EndpointRange(const std::string & endpoint)
+    : fields_(),
+      size_(1)
+{
+    // Either a port range or an IPv4 address with a last byte range.
+    static const boost::regex range("((?:\\d+\\.){3})?(\\d+)-(\\d+)");
+
+    std::istringstream in{endpoint};
+    std::string field;
+    while (std::getline(in, field, ':'))
+    {
+        boost::smatch m;
+        if (! boost::regex_match(field, m, range))
+        {
+            fields_.push_back(Field{field, 0, 0});
+            continue;
+        }
+
+        std::uint64_t const first = std::stoull(m.str(2)),
+                            last = std::stoull(m.str(3));
+        // An address byte can't exceed 255, a port 65535.
+        std::uint64_t const max = m[1].matched ? 0xff : 0xffff;
+        if (last < first || last > max)
+        {
+            std::ostringstream error;
+            error << "invalid range '" << field << "' in endpoint '"
+                  << endpoint << "'";
+            throw std::runtime_error(error.str());
+        }
+
+        fields_.push_back(Field{m.str(1), first, last - first + 1});
+        size_ *= fields_.back().count;
+        if (size_ > MAX_SIZE)
+        {
+            std::ostringstream error;
+            error << "endpoint '" << endpoint << "' describes more than "
+                  << MAX_SIZE << " sessions";
+            throw std::runtime_error(error.str());
+        }
+    }
+}
+
+std::string
+EndpointRange::operator[](std::size_t index) const
+{
+    std::vector<std::uint64_t> values(fields_.size());
+    for (std::size_t i = fields_.size(); i-- != 0; )
+    {
+        auto const& f = fields_[i];
+        if (! f.count)
+            continue;
+
+        values[i] = f.first + index % f.count;
+        index /= f.count;
+    }
+
+    std::string endpoint;
+    for (std::size_t i = 0, e = fields_.size(); i != e; ++i)
+    {
+        if (i)
+            endpoint += ':';
+        endpoint += fields_[i].prefix;
+        if (fields_[i].count)
+            endpoint += std::to_string(values[i]);
+    }
+
+    return endpoint;
+}
+
+} // namespace net_tester
+} // namespace enyx
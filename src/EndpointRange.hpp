@@ -0,0 +1,75 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace enyx {
+namespace net_tester {
+
+// An endpoint whose IPv4 hosts last byte and ports may be ranges,
+// e.g. "10.0.0.1-16:0:10.1.0.1:20000-20999" describes the 16000
+// endpoints connecting each of the 16 local hosts to each of the
+// 1000 remote ports.
+//
+// The endpoints are only built when requested, hence describing
+// many sessions doesn't cost more memory than a single one. Their
+// sessions are all created at startup though, hence a range can't
+// describe more than MAX_SIZE endpoints.
+class EndpointRange
+{
+public:
+    static constexpr std::size_t MAX_SIZE = 1 << 20;
+
+public:
+    explicit
+    EndpointRange(const std::string & endpoint);
+
+    std::size_t
+    size() const noexcept
+    { return size_; }
+
+    // The last field varies the fastest.
+    std::string
+    operator[](std::size_t index) const;
+
+private:
+    struct Field
+    {
+        std::string prefix;
+        std::uint64_t first;
+        std::uint64_t count;
+    };
+
+private:
+    std::vector<Field> fields_;
+    std::size_t size_;
+};
+
+} // namespace net_tester
+} // namespace enyx
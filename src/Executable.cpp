@@ -35,7 +35,9 @@
 
 #include "SessionConfiguration.hpp"
 #include "ApplicationConfiguration.hpp"
+#include "EndpointRange.hpp"
 #include "Application.hpp"
+#include "Sequence.hpp"
 
 namespace enyx {
 namespace net_tester {
@@ -47,6 +49,12 @@ namespace {
 
 constexpr Size DEFAULT_BANDWIDTH = Size(128 * 1000 * 1000, Size::SI);
 
+// Maximum count of messages accepted by sendmmsg()/recvmmsg() (UIO_MAXIOV).
+constexpr std::size_t MAX_BATCH_SIZE = 1024;
+
+// A message must fit in a single UDP datagram.
+constexpr std::size_t MAX_MESSAGE_SIZE = 65507;
+
 void
 fill_configuration(SessionConfiguration & c,
                    const po::options_description & options,
@@ -62,12 +70,207 @@ fill_configuration(SessionConfiguration & c,
     if (args.count("connect") && args.count("listen"))
         throw std::runtime_error{"--connect and --listen are mutually exclusive"};
 
+    // Reject invalid ranges before any session is created.
+    EndpointRange{c.endpoint};
+
     if (args["bandwidth-sampling-frequency"].as<std::uint64_t>() == 0)
         throw std::runtime_error{"invalid --bandwidth-sampling-frequency"};
 
-    if (! args.count("size") || args["size"].as<Size>() == 0)
+    // Churn connections only exchange --size-per-message.
+    if (c.workload != SessionConfiguration::CHURN &&
+            (! args.count("size") || args["size"].as<Size>() == 0))
         throw std::runtime_error{"--size is required"};
 
+    if (c.batch_size == 0 || c.batch_size > MAX_BATCH_SIZE)
+        throw std::runtime_error{"invalid --batch-size"};
+
+    if (c.batch_size > 1 && c.engine == SessionConfiguration::IO_URING)
+        throw std::runtime_error{"--batch-size isn't compatible with "
+                "--engine=io_uring"};
+
+    if (c.offload != SessionConfiguration::NO_OFFLOAD &&
+            c.engine == SessionConfiguration::IO_URING)
+        throw std::runtime_error{"--offload isn't compatible with "
+                "--engine=io_uring"};
+
+    if (is_gso_enabled(c) && c.packet_size.low() != c.packet_size.high())
+        throw std::runtime_error{"--offload=gso requires a fixed "
+                "--max-datagram-size"};
+
+    if (c.zerocopy && c.protocol != SessionConfiguration::TCP)
+        throw std::runtime_error{"--zerocopy requires --protocol=tcp"};
+
+    if (c.zerocopy && c.engine == SessionConfiguration::IO_URING)
+        throw std::runtime_error{"--zerocopy isn't compatible with "
+                "--engine=io_uring"};
+
+#ifndef __linux__
+    if (c.pacing == SessionConfiguration::KERNEL)
+        throw std::runtime_error{"--pacing=kernel is only supported on Linux"};
+
+    if (c.timestamping != SessionConfiguration::NO_TIMESTAMPING)
+        throw std::runtime_error{"--timestamping is only supported on Linux"};
+#endif
+
+    if (c.timestamping != SessionConfiguration::NO_TIMESTAMPING &&
+            (c.engine == SessionConfiguration::IO_URING ||
+             c.batch_size > 1 ||
+             c.offload != SessionConfiguration::NO_OFFLOAD ||
+             c.zerocopy ||
+             c.workload == SessionConfiguration::CHURN))
+        throw std::runtime_error{"--timestamping isn't compatible with "
+                "--engine=io_uring, --batch-size, --offload, --zerocopy "
+                "and --workload=churn"};
+
+    if (c.workload != SessionConfiguration::STREAM)
+    {
+        if (c.message_size == 0 || c.message_size > MAX_MESSAGE_SIZE)
+            throw std::runtime_error{"invalid --size-per-message"};
+
+        if (c.direction != SessionConfiguration::BOTH)
+            throw std::runtime_error{"--workload=ping|pong|churn requires "
+                    "--mode=both"};
+
+        if (c.batch_size > 1 || c.offload != SessionConfiguration::NO_OFFLOAD)
+            throw std::runtime_error{"--workload=ping|pong|churn isn't "
+                    "compatible with --batch-size and --offload"};
+
+        if (c.response_size > MAX_MESSAGE_SIZE)
+            throw std::runtime_error{"invalid --response-size"};
+    }
+    else if (c.response_size != 0)
+        throw std::runtime_error{"--response-size requires "
+                "--workload=ping|pong|churn"};
+
+    if (c.pipeline_depth == 0 ||
+            (c.pipeline_depth > 1 && c.workload != SessionConfiguration::PING))
+        throw std::runtime_error{"invalid --pipeline-depth, only "
+                "--workload=ping sends several requests at once"};
+
+    if (c.workload == SessionConfiguration::CHURN)
+    {
+        if (! args.count("connect") || c.protocol != SessionConfiguration::TCP)
+            throw std::runtime_error{"--workload=churn requires --connect "
+                    "and --protocol=tcp"};
+
+        if (c.connections == 0)
+            throw std::runtime_error{"--workload=churn requires "
+                    "--connections"};
+
+        if (c.churn_concurrency == 0)
+            throw std::runtime_error{"invalid --churn-concurrency"};
+
+        if (c.churn_timeout.is_special() ||
+                c.churn_timeout <= pt::time_duration{})
+            throw std::runtime_error{"invalid --churn-timeout"};
+
+        if (c.engine == SessionConfiguration::IO_URING || c.zerocopy ||
+                c.cpu_steering)
+            throw std::runtime_error{"--workload=churn isn't compatible "
+                    "with --engine=io_uring, --zerocopy and --cpu-steering"};
+    }
+    else if (c.churn_rate || ! args["churn-concurrency"].defaulted() ||
+             ! args["churn-timeout"].defaulted())
+        throw std::runtime_error{"--churn-rate, --churn-concurrency and "
+                "--churn-timeout require --workload=churn"};
+
+    if (c.sequence_header)
+    {
+        if (c.protocol != SessionConfiguration::UDP)
+            throw std::runtime_error{"--sequence-header requires "
+                    "--protocol=udp"};
+
+        if (c.workload != SessionConfiguration::STREAM ||
+                c.offload != SessionConfiguration::NO_OFFLOAD ||
+                c.engine == SessionConfiguration::IO_URING)
+            throw std::runtime_error{"--sequence-header isn't compatible "
+                    "with --workload=ping|pong, --offload and "
+                    "--engine=io_uring"};
+
+        if (c.packet_size.low() < SequenceHeader::SIZE)
+            throw std::runtime_error{"--max-datagram-size is too small "
+                    "for --sequence-header"};
+    }
+
+    if (args.count("listen") && c.protocol == SessionConfiguration::UDP)
+    {
+        if (c.engine == SessionConfiguration::IO_URING ||
+                c.workload != SessionConfiguration::STREAM)
+            throw std::runtime_error{"--listen with --protocol=udp isn't "
+                    "compatible with --engine=io_uring and "
+                    "--workload=ping|pong"};
+
+        if (c.direction == SessionConfiguration::BOTH &&
+                c.offload != SessionConfiguration::NO_OFFLOAD)
+            throw std::runtime_error{"--listen with --protocol=udp and "
+                    "--mode=both isn't compatible with --offload"};
+    }
+
+    if (c.reuse_port)
+    {
+        if (! args.count("listen") || c.protocol != SessionConfiguration::UDP)
+            throw std::runtime_error{"--reuse-port requires --listen and "
+                    "--protocol=udp"};
+
+        if (c.direction == SessionConfiguration::TX)
+            throw std::runtime_error{"--reuse-port isn't compatible with "
+                    "--mode=tx"};
+    }
+
+    if (c.announce && (! args.count("connect") ||
+            c.protocol != SessionConfiguration::UDP ||
+            c.direction != SessionConfiguration::RX))
+        throw std::runtime_error{"--announce requires --connect, "
+                "--protocol=udp and --mode=rx"};
+
+    if (c.connections && c.workload != SessionConfiguration::CHURN &&
+            (! args.count("listen") || c.protocol != SessionConfiguration::TCP))
+        throw std::runtime_error{"--connections requires --listen and "
+                "--protocol=tcp, or --workload=churn"};
+
+    if (c.send_rate)
+    {
+        if (c.protocol != SessionConfiguration::UDP)
+            throw std::runtime_error{"--tx-rate requires --protocol=udp"};
+
+        if (is_gso_enabled(c) || c.burst != 0 ||
+                c.pacing != SessionConfiguration::TIMER)
+            throw std::runtime_error{"--tx-rate isn't compatible with "
+                    "--offload=gso, --burst and --pacing=kernel"};
+    }
+
+    if (! c.send_schedule.empty())
+    {
+        if (c.send_rate || c.burst != 0 ||
+                c.pacing != SessionConfiguration::TIMER ||
+                c.arrival != SessionConfiguration::UNIFORM)
+            throw std::runtime_error{"--tx-schedule isn't compatible with "
+                    "--tx-rate, --burst, --pacing=kernel and --arrival"};
+
+        if (c.send_schedule.points().back().bandwidth == 0)
+            throw std::runtime_error{"--tx-schedule must end with a "
+                    "non-zero bandwidth"};
+    }
+
+    if (c.arrival != SessionConfiguration::UNIFORM)
+    {
+        if (c.send_rate || c.burst != 0 ||
+                c.pacing != SessionConfiguration::TIMER)
+            throw std::runtime_error{"--arrival isn't compatible with "
+                    "--tx-rate, --burst and --pacing=kernel"};
+
+        if (c.arrival_burst == 0)
+            throw std::runtime_error{"invalid --arrival-burst"};
+
+        if (c.arrival_gap.is_special() || c.arrival_gap.is_negative() ||
+                (c.arrival == SessionConfiguration::MICROBURST &&
+                 c.arrival_gap == pt::time_duration{}))
+            throw std::runtime_error{"invalid --arrival-gap"};
+    }
+
+    if (c.cpu_steering && ! c.connections)
+        throw std::runtime_error{"--cpu-steering requires --connections"};
+
     if (c.direction == SessionConfiguration::TX &&
             c.shutdown_policy == SessionConfiguration::RECEIVE_COMPLETE)
         throw std::runtime_error{"TX mode isn't compatible with shutdown "
@@ -127,10 +330,17 @@ parse(int argc, char ** argv)
     file_required.add_options()
         ("connect,c",
             po::value<std::string>(&c.endpoint),
-            "Connect to following address\n")
+            "Connect to following address. The ports and the IPv4 "
+            "addresses last byte may be ranges, e.g. "
+            "10.0.0.1-16:0:10.1.0.1:20000-20999, each endpoint of the "
+            "range being a distinct session\n")
         ("listen,l",
             po::value<std::string>(&c.endpoint),
-            "Listen on following address\n")
+            "Listen on following address. With --protocol=udp, the "
+            "session receives from any peer (--mode=rx), echoes each "
+            "datagram back to its sender (--mode=both) or sends to the "
+            "first peer heard from (--mode=tx). Accepts the same ranges "
+            "as --connect\n")
         ("size,s",
             po::value<Size>(&c.size),
             "Amount of data to send (e.g. 8KiB, 16MiB, 1Gibit, 1GiB)\n");
@@ -146,6 +356,18 @@ parse(int argc, char ** argv)
             po::value<Size>(&c.send_bandwidth)
                 ->default_value(DEFAULT_BANDWIDTH),
             "Limit send bandwidth (e.g. 8kB, 16MB, 1Gbit, 1GB)\n")
+        ("tx-schedule",
+            po::value<BandwidthSchedule>(&c.send_schedule),
+            "Change the send bandwidth over time, following linearly "
+            "interpolated seconds:bandwidth points (e.g. "
+            "0:10MB,30:1GB,30:100MB) or the seconds,bandwidth lines of "
+            "a CSV file (e.g. @ramp.csv)\n")
+        ("tx-rate",
+            po::value<std::uint64_t>(&c.send_rate)
+                ->default_value(0),
+            "With --protocol=udp, limit the sent datagrams per second "
+            "instead of the send bandwidth, each datagram size being "
+            "picked from --max-datagram-size, 0 disables\n")
         ("rx-bandwidth,r",
             po::value<Size>(&c.receive_bandwidth)
                 ->default_value(DEFAULT_BANDWIDTH),
@@ -154,6 +376,37 @@ parse(int argc, char ** argv)
             po::value<uint64_t>(&c.bandwidth_sampling_frequency)
                 ->default_value(1000),
             "Bandwidth calculation frequency Hz\n")
+        ("burst",
+            po::value<Size>(&c.burst)
+                ->default_value(0),
+            "Carry the bandwidth unused by late slices over the next "
+            "ones, up to this size (e.g. 64KiB), 0B disables\n")
+        ("pacing",
+            po::value<SessionConfiguration::Pacing>(&c.pacing)
+                ->default_value(SessionConfiguration::TIMER),
+            "How the send bandwidth is limited. Accepted values:\n"
+            "  - timer Send a slice each sampling period\n"
+            "  - kernel Stream through a socket paced with "
+            "SO_MAX_PACING_RATE, which requires the fq qdisc for UDP\n")
+        ("arrival",
+            po::value<SessionConfiguration::Arrival>(&c.arrival)
+                ->default_value(SessionConfiguration::UNIFORM),
+            "How the sent data arrives over time. Accepted values:\n"
+            "  - uniform A slice each sampling period\n"
+            "  - on-off Bursts of --arrival-burst sent at --tx-bandwidth, "
+            "separated by --arrival-gap idle periods\n"
+            "  - poisson Slices separated by exponentially distributed "
+            "intervals averaging --tx-bandwidth\n"
+            "  - microburst A whole --arrival-burst every --arrival-gap\n")
+        ("arrival-burst",
+            po::value<Size>(&c.arrival_burst)
+                ->default_value(Size(64 * 1024)),
+            "Bytes count of each on-off or microburst burst\n")
+        ("arrival-gap",
+            po::value<pt::time_duration>(&c.arrival_gap)
+                ->default_value(pt::milliseconds(1)),
+            "Idle period following each on-off burst, or interval "
+            "between microbursts\n")
         ("verify,v",
             po::value<SessionConfiguration::Verify>(&c.verify)
                 ->default_value(SessionConfiguration::NONE),
@@ -172,7 +425,50 @@ parse(int argc, char ** argv)
             po::value<pt::time_duration>(&c.duration_margin)
                 ->default_value(pt::not_a_date_time, "infinity"),
             "Extra time from theoretical test time allowed to"
-            " complete without timeout error\n");
+            " complete without timeout error\n")
+        ("engine",
+            po::value<SessionConfiguration::Engine>(&c.engine)
+                ->default_value(SessionConfiguration::ASIO),
+            "I/O engine used to send and receive. Accepted values:\n"
+            "  - asio\n  - io_uring\n")
+        ("timestamping",
+            po::value<SessionConfiguration::Timestamping>(&c.timestamping)
+                ->default_value(SessionConfiguration::NO_TIMESTAMPING),
+            "Split the send and receive latencies with the kernel "
+            "SO_TIMESTAMPING reports into user to qdisc, qdisc to "
+            "driver and driver to user histograms. Accepted values:\n"
+            "  - none\n"
+            "  - software\n"
+            "  - hardware Also report driver to wire and wire to "
+            "driver, requires the NIC timestamping enabled (e.g. with "
+            "hwstamp_ctl) and its clock synchronized (e.g. with "
+            "phc2sys)\n")
+        ("workload",
+            po::value<SessionConfiguration::Workload>(&c.workload)
+                ->default_value(SessionConfiguration::STREAM),
+            "Traffic pattern. Accepted values:\n"
+            "  - stream Send and receive as fast as bandwidth allows\n"
+            "  - ping Send a message and time its echo\n"
+            "  - pong Echo each received message\n"
+            "  - churn Open --connections connections, each one sending "
+            "a message, receiving its echo and closing\n"
+            "bandwidth limits are ignored by ping, pong and churn\n")
+        ("size-per-message",
+            po::value<Size>(&c.message_size)
+                ->default_value(Size{64}),
+            "Size of ping, pong and churn messages, a message is sent in "
+            "a single UDP datagram (e.g. 64B, 1KiB)\n")
+        ("response-size",
+            po::value<Size>(&c.response_size)
+                ->default_value(0),
+            "Size of the response to each ping or churn message, pong "
+            "answers with it instead of echoing the message, must be "
+            "the same on both sides, 0B echoes the message\n")
+        ("pipeline-depth",
+            po::value<std::size_t>(&c.pipeline_depth)
+                ->default_value(1),
+            "Count of ping messages sent without waiting for their "
+            "response, the responses being received in order\n");
 
     po::options_description file_udp_optional{"Udp related optional arguments"};
     file_udp_optional.add_options()
@@ -182,7 +478,36 @@ parse(int argc, char ** argv)
             "UDP and TCP packet maximum size. Accepted values:\n"
             "  - X The maximum size is equal to X\n"
             "  - X-Y The maximum size is randomly chosen for each packet "
-            "between X & Y (inclusive)\n");
+            "between X & Y (inclusive)\n")
+        ("batch-size,B",
+            po::value<std::size_t>(&c.batch_size)
+                ->default_value(1),
+            "Maximum count of datagrams sent or received with a single "
+            "sendmmsg()/recvmmsg() call\n")
+        ("offload",
+            po::value<SessionConfiguration::Offload>(&c.offload)
+                ->default_value(SessionConfiguration::NO_OFFLOAD),
+            "UDP segmentation offload. Accepted values:\n"
+            "  - none\n"
+            "  - gso Send up to 64KiB segmented in --max-datagram-size "
+            "datagrams per call\n"
+            "  - gro Receive coalesced datagrams\n"
+            "  - both\n")
+        ("sequence-header",
+            po::bool_switch(&c.sequence_header),
+            "Prepend a sequence number, session id and send timestamp to "
+            "each datagram to count lost, reordered, duplicated and late "
+            "datagrams\n")
+        ("reuse-port",
+            po::value<std::size_t>(&c.reuse_port)
+                ->default_value(0),
+            "With --listen, bind this count of SO_REUSEPORT sockets spread "
+            "over the threads, sharing --size\n")
+        ("announce",
+            po::bool_switch(&c.announce),
+            "With --connect and --mode=rx, send an empty datagram when "
+            "starting so that a listening source (--listen --mode=tx) "
+            "knows where to send\n");
 
     po::options_description file_tcp_optional{"Tcp related optional arguments"};
     file_tcp_optional.add_options()
@@ -190,7 +515,37 @@ parse(int argc, char ** argv)
             po::value<SessionConfiguration::ShutdownPolicy>(&c.shutdown_policy)
                 ->default_value(SessionConfiguration::SEND_COMPLETE),
             "Connection shutdown policy. Accepted values:\n"
-            "  - send_complete\n  - receive_complete\n  - wait_for_peer\n");
+            "  - send_complete\n  - receive_complete\n  - wait_for_peer\n")
+        ("zerocopy",
+            po::bool_switch(&c.zerocopy),
+            "Send with MSG_ZEROCOPY, the kernel pins the send buffer "
+            "instead of copying it\n")
+        ("connections",
+            po::value<std::size_t>(&c.connections)
+                ->default_value(0),
+            "With --listen, accept this count of connections, each one "
+            "being a session, with one SO_REUSEPORT acceptor per thread. "
+            "With --workload=churn, open this count of connections\n")
+        ("churn-rate",
+            po::value<std::uint64_t>(&c.churn_rate)
+                ->default_value(0),
+            "With --workload=churn, open this count of connections per "
+            "second, 0 opens the next one as soon as one completes\n")
+        ("churn-concurrency",
+            po::value<std::size_t>(&c.churn_concurrency)
+                ->default_value(1),
+            "With --workload=churn, maximum count of connections in "
+            "flight\n")
+        ("churn-timeout",
+            po::value<pt::time_duration>(&c.churn_timeout)
+                ->default_value(pt::seconds(5), "00:00:05"),
+            "With --workload=churn, time allowed to each connection from "
+            "its connect to the peer end of stream, a connection exceeding "
+            "it fails with a timeout\n")
+        ("cpu-steering",
+            po::bool_switch(&c.cpu_steering),
+            "With --connections, accept each connection on the acceptor "
+            "of the thread whose index is the receiving CPU\n");
 
     po::options_description file_all{"CONFIGURATION FILE OPTIONS"};
     file_all.add(file_required)
@@ -208,6 +563,46 @@ parse(int argc, char ** argv)
         ("cpu-cores,x",
             po::value<CpuCoreIdRanges>(&app_configuration.cpus),
             "Threads used to process network events\n")
+        ("polling",
+            po::value<ApplicationConfiguration::Polling>(&app_configuration.polling)
+                ->default_value(ApplicationConfiguration::SPIN),
+            "How the threads wait for network events. Accepted values:\n"
+            "  - spin\n  - adaptive\n  - block\n")
+        ("spin-duration",
+            po::value<pt::time_duration>(&app_configuration.spin_duration)
+                ->default_value(pt::microseconds(50), "00:00:00.000050"),
+            "Time a thread keeps spinning without event before blocking, "
+            "with --polling=adaptive\n")
+        ("report-interval,i",
+            po::value<pt::time_duration>(&app_configuration.report_interval)
+                ->default_value(pt::not_a_date_time, "none"),
+            "Print the statistics of each session at this interval "
+            "(e.g. 00:00:01)\n")
+        ("slowest-sessions",
+            po::value<std::size_t>(&app_configuration.slowest_sessions_count)
+                ->default_value(5),
+            "Count of slowest sessions listed by the summary printed "
+            "when several sessions are run\n")
+        ("perf-counters",
+            po::bool_switch(&app_configuration.perf_counters),
+            "Print the cycles, instructions, cache misses, branch misses, "
+            "page faults and context switches of each thread, counted "
+            "with perf_event_open while it runs\n")
+        ("output-format",
+            po::value<ApplicationConfiguration::OutputFormat>(
+                    &app_configuration.output_format)
+                ->default_value(ApplicationConfiguration::TEXT),
+            "Format of the --output-file results, with exact bytes counts "
+            "and nanoseconds durations. Accepted values:\n"
+            "  - text Only print the statistics\n"
+            "  - json An array of one object per session, connection, "
+            "listener, churn and total\n"
+            "  - csv One line per session, connection, listener, churn "
+            "and total\n")
+        ("output-file,o",
+            po::value<std::string>(&app_configuration.output_file),
+            "Write the results to this file, the statistics being "
+            "printed as well\n")
         ("help,h",
             "Print the command lines arguments\n");
 
@@ -229,6 +624,19 @@ parse(int argc, char ** argv)
         throw std::runtime_error{"help is requested"};
     }
 
+    if (! app_configuration.report_interval.is_special() &&
+            app_configuration.report_interval <= pt::time_duration{})
+        throw std::runtime_error{"invalid --report-interval"};
+
+    if ((app_configuration.output_format != ApplicationConfiguration::TEXT) !=
+            ! app_configuration.output_file.empty())
+        throw std::runtime_error{"--output-format=json|csv and "
+                "--output-file go together"};
+
+    if (app_configuration.spin_duration.is_special() ||
+            app_configuration.spin_duration.is_negative())
+        throw std::runtime_error{"invalid --spin-duration"};
+
     if (! args.count("configuration-file"))
         throw std::runtime_error{"--configuration-file argument is required"};
 
@@ -0,0 +1,122 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace enyx {
+namespace net_tester {
+
+Histogram::Histogram()
+    : buckets_(),
+      count_(),
+      min_(std::numeric_limits<std::uint64_t>::max()),
+      max_()
+{
+}
+
+void
+Histogram::initialize()
+{
+    // One bucket per index of the largest value.
+    buckets_.assign(index_of(std::numeric_limits<std::uint64_t>::max()) + 1, 0);
+}
+
+void
+Histogram::merge(const Histogram & other)
+{
+    if (! other.count_)
+        return;
+
+    if (buckets_.empty())
+        initialize();
+
+    for (std::size_t i = 0, e = other.buckets_.size(); i != e; ++i)
+        buckets_[i] += other.buckets_[i];
+
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+std::uint64_t
+Histogram::highest_value_of(std::size_t index)
+{
+    std::size_t shift = index < SUB_BUCKETS_COUNT ?
+            0 : index / (SUB_BUCKETS_COUNT / 2) - 1;
+    std::uint64_t lowest = std::uint64_t(index - shift * (SUB_BUCKETS_COUNT / 2))
+                           << shift;
+    return lowest + ((std::uint64_t(1) << shift) - 1);
+}
+
+std::uint64_t
+Histogram::percentile(double percentage) const
+{
+    if (! count_)
+        return 0;
+
+    auto rank = std::uint64_t(std::ceil(percentage / 100. * double(count_)));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t cumulated = 0;
+    for (std::size_t i = 0, e = buckets_.size(); i != e; ++i)
+    {
+        cumulated += buckets_[i];
+        if (cumulated >= rank)
+            return std::max(min_, std::min(highest_value_of(i), max_));
+    }
+
+    return max_;
+}
+
+std::ostream &
+write(std::ostream & out, const Histogram & histogram, const char * unit)
+{
+    std::ostream::sentry sentry(out);
+
+    if (sentry)
+        out << "count " << histogram.count()
+            << ", min " << histogram.min() << unit
+            << ", p50 " << histogram.percentile(50.) << unit
+            << ", p90 " << histogram.percentile(90.) << unit
+            << ", p99 " << histogram.percentile(99.) << unit
+            << ", p99.9 " << histogram.percentile(99.9) << unit
+            << ", max " << histogram.max() << unit;
+
+    return out;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const Histogram & histogram)
+{
+    return write(out, histogram, "ns");
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,130 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace enyx {
+namespace net_tester {
+
+// Log-linear histogram of nanoseconds durations in the spirit of
+// HdrHistogram: each power of two range is split into SUB_BUCKETS_COUNT / 2
+// linear buckets, hence values are recorded with a relative error
+// below 2 / SUB_BUCKETS_COUNT.
+//
+// Buckets are allocated by initialize() so record() never allocates.
+class Histogram
+{
+public:
+    Histogram();
+
+    void
+    initialize();
+
+    void
+    record(std::uint64_t value)
+    {
+        ++ buckets_[index_of(value)];
+        ++ count_;
+        if (value < min_)
+            min_ = value;
+        if (value > max_)
+            max_ = value;
+    }
+
+    // Add the values recorded by other, allocating the buckets
+    // if needed.
+    void
+    merge(const Histogram & other);
+
+    std::uint64_t
+    count() const
+    { return count_; }
+
+    std::uint64_t
+    min() const
+    { return count_ ? min_ : 0; }
+
+    std::uint64_t
+    max() const
+    { return max_; }
+
+    // Value below or equal to which the given percentage of
+    // the recorded values fall, e.g. percentile(99.9).
+    std::uint64_t
+    percentile(double percentage) const;
+
+private:
+    enum { SUB_BUCKETS_BITS = 7, SUB_BUCKETS_COUNT = 1 << SUB_BUCKETS_BITS };
+
+private:
+    static std::size_t
+    index_of(std::uint64_t value)
+    {
+        // Values below SUB_BUCKETS_COUNT are recorded exactly,
+        // above the lowest bits are truncated.
+        unsigned magnitude = highest_bit(value | (SUB_BUCKETS_COUNT - 1));
+        unsigned shift = magnitude - (SUB_BUCKETS_BITS - 1);
+        return std::size_t(shift) * (SUB_BUCKETS_COUNT / 2) +
+               std::size_t(value >> shift);
+    }
+
+    static std::uint64_t
+    highest_value_of(std::size_t index);
+
+    static unsigned
+    highest_bit(std::uint64_t value)
+    {
+#if defined(__GNUC__)
+        return 63 - unsigned(__builtin_clzll(value));
+#else
+        unsigned bit = 0;
+        while (value >>= 1)
+            ++ bit;
+        return bit;
+#endif
+    }
+
+private:
+    std::vector<std::uint64_t> buckets_;
+    std::uint64_t count_;
+    std::uint64_t min_;
+    std::uint64_t max_;
+};
+
+// Print the count, min, p50, p90, p99, p99.9 and max in nanoseconds.
+std::ostream &
+operator<<(std::ostream & out, const Histogram & histogram);
+
+// Same as above, for values of another unit (e.g. "B").
+std::ostream &
+write(std::ostream & out, const Histogram & histogram, const char * unit);
+
+} // namespace net_tester
+} // namespace enyx
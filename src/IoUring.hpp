@@ -0,0 +1,213 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace enyx {
+namespace net_tester {
+
+// One io_uring instance per io_service. As each reactor thread owns
+// its io_service, each thread submits to and reaps from its own ring.
+//
+// Submissions issued while running a batch of handlers are flushed
+// with a single io_uring_enter(), and completions are reaped in batch
+// when the ring eventfd is signaled to the io_service reactor.
+class IoUring : public boost::asio::io_service::service
+{
+public:
+    static boost::asio::io_service::id id;
+
+    // A socket known to the ring, either through its index in the
+    // registered files table or through its descriptor.
+    struct File
+    {
+        int descriptor;
+        int slot;
+    };
+
+    class Operation
+    {
+        friend class IoUring;
+
+    public:
+        virtual void
+        complete(int result) = 0;
+
+        virtual void
+        destroy() = 0;
+
+    protected:
+        ~Operation() = default;
+
+    private:
+        Operation * previous_ = nullptr;
+        Operation * next_ = nullptr;
+    };
+
+public:
+    explicit
+    IoUring(boost::asio::io_service & io_service);
+
+    ~IoUring();
+
+    void
+    shutdown() override;
+
+    // Buffers are registered with the kernel by commit_buffers(),
+    // the ones added later use the regular operations.
+    void
+    register_buffer(const void * data, std::size_t size);
+
+    // Must be called before the first submission, throw when the
+    // kernel refuses to pin the buffers (e.g. RLIMIT_MEMLOCK too low).
+    void
+    commit_buffers();
+
+    // Memory pinned by the buffers once committed, in whole pages.
+    std::size_t
+    get_buffers_size() const;
+
+    // Throw when the rings can't pin size bytes of buffers altogether,
+    // i.e. beyond RLIMIT_MEMLOCK without CAP_IPC_LOCK.
+    static void
+    check_locked_memory(std::size_t size);
+
+    File
+    register_file(int descriptor);
+
+    void
+    unregister_file(const File & file);
+
+    template<typename Handler>
+    void
+    async_read(const File & file,
+               const boost::asio::mutable_buffer & buffer,
+               bool is_stream,
+               Handler handler)
+    {
+        auto operation = create_operation(std::move(handler), is_stream);
+        submit_read(file, buffer, operation);
+    }
+
+    template<typename Handler>
+    void
+    async_write(const File & file,
+                const boost::asio::const_buffer & buffer,
+                Handler handler)
+    {
+        auto operation = create_operation(std::move(handler), false);
+        submit_write(file, buffer, operation);
+    }
+
+private:
+    template<typename Handler>
+    class HandlerOperation final : public Operation
+    {
+    public:
+        using allocator_type = typename std::allocator_traits<
+                boost::asio::associated_allocator_t<Handler>>
+                    ::template rebind_alloc<HandlerOperation>;
+
+    public:
+        HandlerOperation(Handler handler, bool is_stream)
+            : handler_(std::move(handler)),
+              is_stream_(is_stream)
+        { }
+
+        virtual void
+        complete(int result) override
+        {
+            boost::system::error_code failure;
+            std::size_t bytes_transferred = 0;
+            if (result < 0)
+                failure = boost::system::error_code(-result,
+                        boost::system::system_category());
+            else if (result == 0 && is_stream_)
+                failure = boost::asio::error::eof;
+            else
+                bytes_transferred = std::size_t(result);
+
+            // Release the memory before invoking the handler
+            // as it will usually schedule the next operation.
+            allocator_type allocator(
+                    boost::asio::get_associated_allocator(handler_));
+            Handler handler(std::move(handler_));
+            this->~HandlerOperation();
+            allocator.deallocate(this, 1);
+
+            handler(failure, bytes_transferred);
+        }
+
+        virtual void
+        destroy() override
+        {
+            allocator_type allocator(
+                    boost::asio::get_associated_allocator(handler_));
+            this->~HandlerOperation();
+            allocator.deallocate(this, 1);
+        }
+
+    private:
+        Handler handler_;
+        bool is_stream_;
+    };
+
+    template<typename Handler>
+    Operation *
+    create_operation(Handler handler, bool is_stream)
+    {
+        using operation_type = HandlerOperation<Handler>;
+        typename operation_type::allocator_type allocator(
+                boost::asio::get_associated_allocator(handler));
+        auto memory = allocator.allocate(1);
+        return new (memory) operation_type(std::move(handler), is_stream);
+    }
+
+    void
+    submit_read(const File & file,
+                const boost::asio::mutable_buffer & buffer,
+                Operation * operation);
+
+    void
+    submit_write(const File & file,
+                 const boost::asio::const_buffer & buffer,
+                 Operation * operation);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace net_tester
+} // namespace enyx
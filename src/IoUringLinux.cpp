@@ -0,0 +1,698 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "IoUring.hpp"
+
+#include <linux/capability.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/system/system_error.hpp>
+
+#ifndef IORING_SQ_CQ_OVERFLOW
+#define IORING_SQ_CQ_OVERFLOW (1U << 1)
+#endif
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+// Sessions have at most a send and a receive in flight,
+// the submission queue is flushed early when full.
+constexpr unsigned QUEUE_DEPTH = 1024;
+
+constexpr unsigned REGISTERED_FILES_COUNT = 4096;
+
+int
+io_uring_setup(unsigned entries, io_uring_params * params)
+{
+    return int(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int
+io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+               unsigned flags)
+{
+    return int(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                         flags, nullptr, 0));
+}
+
+int
+io_uring_register(int fd, unsigned opcode, const void * arg, unsigned count)
+{
+    return int(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+[[noreturn]] void
+throw_errno(const char * what)
+{
+    throw boost::system::system_error{
+            boost::system::error_code{errno, boost::system::system_category()},
+            what};
+}
+
+bool
+has_ipc_lock_capability()
+{
+    __user_cap_header_struct header{_LINUX_CAPABILITY_VERSION_3, 0};
+    __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3]{};
+    return ::syscall(__NR_capget, &header, data) == 0 &&
+           (data[CAP_TO_INDEX(CAP_IPC_LOCK)].effective &
+                CAP_TO_MASK(CAP_IPC_LOCK));
+}
+
+void *
+map_ring(int fd, std::size_t size, off_t offset)
+{
+    void * p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, offset);
+    if (p == MAP_FAILED)
+        throw_errno("io_uring mmap");
+    return p;
+}
+
+template<typename Type>
+Type *
+at(void * base, std::uint32_t offset)
+{
+    return reinterpret_cast<Type *>(static_cast<char *>(base) + offset);
+}
+
+struct RegisteredBuffer
+{
+    const char * begin;
+    const char * end;
+    unsigned index;
+};
+
+} // anonymous namespace
+
+struct IoUring::Impl
+{
+    explicit
+    Impl(boost::asio::io_service & io_service);
+
+    ~Impl();
+
+    io_uring_sqe *
+    get_sqe();
+
+    void
+    prepare(io_uring_sqe * sqe, const File & file, Operation * operation);
+
+    const RegisteredBuffer *
+    find_buffer(const void * data, std::size_t size) const;
+
+    void
+    register_buffers();
+
+    void
+    skip_uncommitted_buffers();
+
+    void
+    schedule_submit();
+
+    void
+    submit();
+
+    void
+    reap();
+
+    void
+    flush_overflow();
+
+    void
+    arm_wait();
+
+    void
+    close();
+
+    boost::asio::io_service & io_service_;
+    int fd_;
+    io_uring_params params_;
+
+    void * sq_ring_;
+    std::size_t sq_ring_size_;
+    void * cq_ring_;
+    std::size_t cq_ring_size_;
+    io_uring_sqe * sqes_;
+    std::size_t sqes_size_;
+
+    unsigned * sq_head_;
+    unsigned * sq_tail_;
+    unsigned sq_mask_;
+    unsigned * sq_flags_;
+    unsigned * sq_array_;
+    unsigned * cq_head_;
+    unsigned * cq_tail_;
+    unsigned cq_mask_;
+    unsigned * cq_overflow_;
+    io_uring_cqe * cqes_;
+
+    unsigned sq_local_tail_;
+    unsigned to_submit_;
+
+    boost::asio::posix::stream_descriptor event_;
+    std::uint64_t event_value_;
+
+    std::vector<RegisteredBuffer> buffers_;
+    bool buffers_committed_;
+
+    std::vector<int> free_slots_;
+
+    Operation * operations_;
+    bool is_submit_scheduled_;
+    bool is_wait_armed_;
+};
+
+IoUring::Impl::Impl(boost::asio::io_service & io_service)
+    : io_service_(io_service),
+      fd_(-1),
+      params_(),
+      sq_ring_(), sq_ring_size_(),
+      cq_ring_(), cq_ring_size_(),
+      sqes_(), sqes_size_(),
+      sq_head_(), sq_tail_(), sq_mask_(), sq_flags_(), sq_array_(),
+      cq_head_(), cq_tail_(), cq_mask_(), cq_overflow_(), cqes_(),
+      sq_local_tail_(), to_submit_(),
+      event_(io_service),
+      event_value_(),
+      buffers_(),
+      buffers_committed_(),
+      free_slots_(),
+      operations_(),
+      is_submit_scheduled_(),
+      is_wait_armed_()
+{
+    fd_ = io_uring_setup(QUEUE_DEPTH, &params_);
+    if (fd_ < 0)
+        throw_errno("io_uring_setup");
+
+    // Without it, the completions overflowing the queue are dropped
+    // and their sessions stall (the send and receive operations
+    // require a more recent kernel anyway).
+    if (! (params_.features & IORING_FEAT_NODROP))
+    {
+        ::close(fd_);
+        throw std::runtime_error{"io_uring lacks IORING_FEAT_NODROP "
+                                 "(Linux 5.5)"};
+    }
+
+    sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+    if (params_.features & IORING_FEAT_SINGLE_MMAP)
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+    sq_ring_ = map_ring(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+    if (params_.features & IORING_FEAT_SINGLE_MMAP)
+        cq_ring_ = sq_ring_;
+    else
+        cq_ring_ = map_ring(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+
+    sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(map_ring(fd_, sqes_size_,
+                                                 IORING_OFF_SQES));
+
+    sq_head_ = at<unsigned>(sq_ring_, params_.sq_off.head);
+    sq_tail_ = at<unsigned>(sq_ring_, params_.sq_off.tail);
+    sq_mask_ = *at<unsigned>(sq_ring_, params_.sq_off.ring_mask);
+    sq_flags_ = at<unsigned>(sq_ring_, params_.sq_off.flags);
+    sq_array_ = at<unsigned>(sq_ring_, params_.sq_off.array);
+    cq_head_ = at<unsigned>(cq_ring_, params_.cq_off.head);
+    cq_tail_ = at<unsigned>(cq_ring_, params_.cq_off.tail);
+    cq_mask_ = *at<unsigned>(cq_ring_, params_.cq_off.ring_mask);
+    cq_overflow_ = at<unsigned>(cq_ring_, params_.cq_off.overflow);
+    cqes_ = at<io_uring_cqe>(cq_ring_, params_.cq_off.cqes);
+    sq_local_tail_ = *sq_tail_;
+
+    // The eventfd is signaled on each completion, and watched
+    // by the io_service reactor.
+    int event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0)
+        throw_errno("eventfd");
+    event_.assign(event_fd);
+
+    if (io_uring_register(fd_, IORING_REGISTER_EVENTFD, &event_fd, 1) < 0)
+        throw_errno("io_uring_register eventfd");
+
+    // Sparse files table, updated as sockets are connected.
+    std::vector<int> files(REGISTERED_FILES_COUNT, -1);
+    if (io_uring_register(fd_, IORING_REGISTER_FILES,
+                          files.data(), unsigned(files.size())) == 0)
+        for (unsigned i = REGISTERED_FILES_COUNT; i != 0; --i)
+            free_slots_.push_back(int(i - 1));
+}
+
+IoUring::Impl::~Impl()
+{
+    close();
+}
+
+void
+IoUring::Impl::close()
+{
+    if (fd_ < 0)
+        return;
+
+    boost::system::error_code failure;
+    event_.close(failure);
+
+    ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_)
+        ::munmap(cq_ring_, cq_ring_size_);
+    ::munmap(sq_ring_, sq_ring_size_);
+    ::close(fd_);
+    fd_ = -1;
+}
+
+io_uring_sqe *
+IoUring::Impl::get_sqe()
+{
+    // Submission queue is full, flush it now.
+    if (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) ==
+            params_.sq_entries)
+        submit();
+
+    unsigned index = sq_local_tail_ & sq_mask_;
+    io_uring_sqe * sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++ sq_local_tail_;
+    ++ to_submit_;
+
+    return sqe;
+}
+
+void
+IoUring::Impl::prepare(io_uring_sqe * sqe,
+                       const File & file,
+                       Operation * operation)
+{
+    if (file.slot >= 0)
+    {
+        sqe->fd = file.slot;
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    else
+        sqe->fd = file.descriptor;
+
+    sqe->user_data = reinterpret_cast<std::uintptr_t>(operation);
+
+    // Keep track of in flight operations to release their
+    // handler on shutdown.
+    operation->previous_ = nullptr;
+    operation->next_ = operations_;
+    if (operations_)
+        operations_->previous_ = operation;
+    operations_ = operation;
+
+    __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+    schedule_submit();
+}
+
+const RegisteredBuffer *
+IoUring::Impl::find_buffer(const void * data, std::size_t size) const
+{
+    if (! buffers_committed_)
+        return nullptr;
+
+    auto begin = static_cast<const char *>(data);
+    auto it = std::upper_bound(buffers_.begin(), buffers_.end(), begin,
+            [](const char * p, const RegisteredBuffer & b) {
+                return p < b.begin;
+            });
+
+    if (it == buffers_.begin())
+        return nullptr;
+
+    -- it;
+    if (begin + size > it->end)
+        return nullptr;
+
+    return &*it;
+}
+
+void
+IoUring::Impl::register_buffers()
+{
+    buffers_committed_ = true;
+
+    if (buffers_.empty())
+        return;
+
+    std::sort(buffers_.begin(), buffers_.end(),
+              [](const RegisteredBuffer & a, const RegisteredBuffer & b) {
+                  return a.begin < b.begin;
+              });
+
+    std::vector<iovec> iovecs;
+    for (auto & buffer : buffers_)
+    {
+        buffer.index = unsigned(iovecs.size());
+        iovecs.push_back(iovec{const_cast<char *>(buffer.begin),
+                               std::size_t(buffer.end - buffer.begin)});
+    }
+
+    if (io_uring_register(fd_, IORING_REGISTER_BUFFERS,
+                          iovecs.data(), unsigned(iovecs.size())) < 0)
+        throw_errno("io_uring buffers registration "
+                    "(check RLIMIT_MEMLOCK, e.g. ulimit -l)");
+}
+
+void
+IoUring::Impl::skip_uncommitted_buffers()
+{
+    // The ring was created after the startup registration (e.g. by
+    // an accepted connection), registering now could fail mid-session
+    // hence the regular operations are used.
+    if (buffers_committed_)
+        return;
+
+    buffers_committed_ = true;
+    buffers_.clear();
+}
+
+void
+IoUring::Impl::schedule_submit()
+{
+    if (is_submit_scheduled_)
+        return;
+
+    // Defer the submission so all operations started by the
+    // currently running handlers are submitted at once.
+    is_submit_scheduled_ = true;
+    io_service_.post([this] {
+        is_submit_scheduled_ = false;
+        submit();
+        reap();
+    });
+}
+
+void
+IoUring::Impl::submit()
+{
+    while (to_submit_)
+    {
+        int submitted = io_uring_enter(fd_, to_submit_, 0, 0);
+        if (submitted < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw_errno("io_uring_enter");
+        }
+
+        to_submit_ -= unsigned(submitted);
+    }
+
+    arm_wait();
+}
+
+void
+IoUring::Impl::reap()
+{
+    for (;;)
+    {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+        // The completions overflowing a full queue are kept by the
+        // kernel until flushed.
+        bool const is_overflowed =
+                tail - head == params_.cq_entries ||
+                (__atomic_load_n(sq_flags_, __ATOMIC_ACQUIRE) &
+                    IORING_SQ_CQ_OVERFLOW);
+
+        while (head != tail)
+        {
+            // Each entry is released before its completion is invoked
+            // as the handler will usually submit a new operation.
+            for (; head != tail; ++ head)
+            {
+                const io_uring_cqe & cqe = cqes_[head & cq_mask_];
+                auto operation = reinterpret_cast<Operation *>(cqe.user_data);
+                int result = cqe.res;
+
+                __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+                if (operation->previous_)
+                    operation->previous_->next_ = operation->next_;
+                else
+                    operations_ = operation->next_;
+                if (operation->next_)
+                    operation->next_->previous_ = operation->previous_;
+
+                operation->complete(result);
+            }
+
+            tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        }
+
+        if (! is_overflowed || fd_ < 0)
+            break;
+
+        flush_overflow();
+    }
+
+    // Even with IORING_FEAT_NODROP, the kernel drops the completions
+    // it can't allocate memory for.
+    if (fd_ >= 0 && __atomic_load_n(cq_overflow_, __ATOMIC_ACQUIRE))
+        throw std::runtime_error{"io_uring dropped completions"};
+
+    arm_wait();
+}
+
+void
+IoUring::Impl::flush_overflow()
+{
+    while (io_uring_enter(fd_, 0, 0, IORING_ENTER_GETEVENTS) < 0)
+        if (errno != EINTR)
+            throw_errno("io_uring_enter");
+}
+
+void
+IoUring::Impl::arm_wait()
+{
+    // Only watch the eventfd while operations are in flight,
+    // so the io_service can run out of work.
+    if (is_wait_armed_ || ! operations_ || fd_ < 0)
+        return;
+
+    is_wait_armed_ = true;
+    event_.async_read_some(boost::asio::buffer(&event_value_,
+                                               sizeof(event_value_)),
+            [this](const boost::system::error_code & failure, std::size_t) {
+                is_wait_armed_ = false;
+                if (failure == boost::asio::error::operation_aborted)
+                    return;
+
+                reap();
+            });
+}
+
+boost::asio::io_service::id IoUring::id;
+
+IoUring::IoUring(boost::asio::io_service & io_service)
+    : boost::asio::io_service::service(io_service),
+      impl_(new Impl(io_service))
+{
+}
+
+IoUring::~IoUring()
+{
+}
+
+void
+IoUring::shutdown()
+{
+    // Closing the ring cancels all the pending operations.
+    impl_->close();
+
+    while (auto operation = impl_->operations_)
+    {
+        impl_->operations_ = operation->next_;
+        operation->destroy();
+    }
+}
+
+void
+IoUring::register_buffer(const void * data, std::size_t size)
+{
+    if (impl_->buffers_committed_)
+        return;
+
+    auto begin = static_cast<const char *>(data);
+    for (auto const& buffer : impl_->buffers_)
+        if (buffer.begin == begin)
+            return;
+
+    impl_->buffers_.push_back(RegisteredBuffer{begin, begin + size, 0});
+}
+
+void
+IoUring::commit_buffers()
+{
+    if (! impl_->buffers_committed_)
+        impl_->register_buffers();
+}
+
+std::size_t
+IoUring::get_buffers_size() const
+{
+    if (impl_->buffers_committed_)
+        return 0;
+
+    // The kernel pins whole pages.
+    auto const page_size = std::uintptr_t(::sysconf(_SC_PAGESIZE));
+    std::size_t size = 0;
+    for (auto const& buffer : impl_->buffers_)
+    {
+        auto const begin = reinterpret_cast<std::uintptr_t>(buffer.begin) /
+                           page_size * page_size;
+        auto const end = (reinterpret_cast<std::uintptr_t>(buffer.end) +
+                          page_size - 1) / page_size * page_size;
+        size += std::size_t(end - begin);
+    }
+
+    return size;
+}
+
+void
+IoUring::check_locked_memory(std::size_t size)
+{
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_MEMLOCK, &limit) < 0)
+        throw_errno("getrlimit RLIMIT_MEMLOCK");
+
+    if (limit.rlim_cur == RLIM_INFINITY || size <= limit.rlim_cur ||
+            has_ipc_lock_capability())
+        return;
+
+    std::ostringstream error;
+    error << "io_uring buffers require " << size << " bytes of locked "
+          << "memory, beyond RLIMIT_MEMLOCK (" << limit.rlim_cur
+          << " bytes, check ulimit -l)";
+    throw std::runtime_error{error.str()};
+}
+
+IoUring::File
+IoUring::register_file(int descriptor)
+{
+    File file{descriptor, -1};
+
+    if (impl_->free_slots_.empty())
+        return file;
+
+    int slot = impl_->free_slots_.back();
+    io_uring_files_update update{};
+    update.offset = unsigned(slot);
+    update.fds = reinterpret_cast<std::uintptr_t>(&descriptor);
+    if (io_uring_register(impl_->fd_, IORING_REGISTER_FILES_UPDATE,
+                          &update, 1) == 1)
+    {
+        impl_->free_slots_.pop_back();
+        file.slot = slot;
+    }
+
+    return file;
+}
+
+void
+IoUring::unregister_file(const File & file)
+{
+    if (file.slot < 0 || impl_->fd_ < 0)
+        return;
+
+    int descriptor = -1;
+    io_uring_files_update update{};
+    update.offset = unsigned(file.slot);
+    update.fds = reinterpret_cast<std::uintptr_t>(&descriptor);
+    if (io_uring_register(impl_->fd_, IORING_REGISTER_FILES_UPDATE,
+                          &update, 1) == 1)
+        impl_->free_slots_.push_back(file.slot);
+}
+
+void
+IoUring::submit_read(const File & file,
+                     const boost::asio::mutable_buffer & buffer,
+                     Operation * operation)
+{
+    impl_->skip_uncommitted_buffers();
+
+    io_uring_sqe * sqe = impl_->get_sqe();
+    sqe->addr = reinterpret_cast<std::uintptr_t>(buffer.data());
+    sqe->len = unsigned(buffer.size());
+
+    if (auto registered = impl_->find_buffer(buffer.data(), buffer.size()))
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = std::uint16_t(registered->index);
+    }
+    else
+        sqe->opcode = IORING_OP_RECV;
+
+    impl_->prepare(sqe, file, operation);
+}
+
+void
+IoUring::submit_write(const File & file,
+                      const boost::asio::const_buffer & buffer,
+                      Operation * operation)
+{
+    impl_->skip_uncommitted_buffers();
+
+    io_uring_sqe * sqe = impl_->get_sqe();
+    sqe->addr = reinterpret_cast<std::uintptr_t>(buffer.data());
+    sqe->len = unsigned(buffer.size());
+
+    if (auto registered = impl_->find_buffer(buffer.data(), buffer.size()))
+    {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->buf_index = std::uint16_t(registered->index);
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->msg_flags = MSG_NOSIGNAL;
+    }
+
+    impl_->prepare(sqe, file, operation);
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,99 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "IoUring.hpp"
+
+#include <stdexcept>
+
+namespace enyx {
+namespace net_tester {
+
+struct IoUring::Impl
+{ };
+
+boost::asio::io_service::id IoUring::id;
+
+IoUring::IoUring(boost::asio::io_service & io_service)
+    : boost::asio::io_service::service(io_service)
+{
+    throw std::runtime_error{"io_uring engine is only supported on Linux"};
+}
+
+IoUring::~IoUring()
+{
+}
+
+void
+IoUring::shutdown()
+{
+}
+
+void
+IoUring::register_buffer(const void *, std::size_t)
+{
+}
+
+void
+IoUring::commit_buffers()
+{
+}
+
+std::size_t
+IoUring::get_buffers_size() const
+{
+    return 0;
+}
+
+void
+IoUring::check_locked_memory(std::size_t)
+{
+}
+
+IoUring::File
+IoUring::register_file(int descriptor)
+{
+    return File{descriptor, -1};
+}
+
+void
+IoUring::unregister_file(const File &)
+{
+}
+
+void
+IoUring::submit_read(const File &,
+                     const boost::asio::mutable_buffer &,
+                     Operation *)
+{
+}
+
+void
+IoUring::submit_write(const File &,
+                      const boost::asio::const_buffer &,
+                      Operation *)
+{
+}
+
+} // namespace net_tester
+} // namespace enyx
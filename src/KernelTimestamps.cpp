@@ -0,0 +1,312 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "KernelTimestamps.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+#   include <linux/errqueue.h>
+#   include <linux/net_tstamp.h>
+#   include <netinet/in.h>
+#   include <sys/socket.h>
+#   include <sys/uio.h>
+#endif
+
+#include <boost/system/system_error.hpp>
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+// Sends whose reports are missing (e.g. a NIC without hardware
+// timestamps) are dropped beyond this count.
+constexpr std::size_t MAX_PENDING_SENDS = 4096;
+
+#ifdef __linux__
+KernelTimestamps::Clock::time_point
+to_time_point(const timespec & t)
+{
+    return KernelTimestamps::Clock::time_point{
+            std::chrono::duration_cast<KernelTimestamps::Clock::duration>(
+                    std::chrono::seconds{t.tv_sec} +
+                    std::chrono::nanoseconds{t.tv_nsec})};
+}
+#endif
+
+} // anonymous namespace
+
+KernelTimestamps::KernelTimestamps(boost::asio::io_service & io_service,
+                                   int descriptor,
+                                   bool is_stream,
+                                   SessionConfiguration::Timestamping timestamping)
+    : io_service_(io_service),
+      descriptor_(descriptor),
+      is_stream_(is_stream),
+      is_hardware_(timestamping == SessionConfiguration::HARDWARE_TIMESTAMPING),
+      next_id_(),
+      pending_sends_(),
+      send_user_to_qdisc_times_(),
+      send_qdisc_to_driver_times_(),
+      send_driver_to_wire_times_(),
+      receive_wire_to_driver_times_(),
+      receive_driver_to_user_times_()
+{
+#ifdef __linux__
+    // The reports carry an id rather than the packet sent.
+    int flags = SOF_TIMESTAMPING_TX_SCHED |
+                SOF_TIMESTAMPING_TX_SOFTWARE |
+                SOF_TIMESTAMPING_RX_SOFTWARE |
+                SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_OPT_ID |
+                SOF_TIMESTAMPING_OPT_TSONLY;
+    if (is_hardware_)
+        flags |= SOF_TIMESTAMPING_TX_HARDWARE |
+                 SOF_TIMESTAMPING_RX_HARDWARE |
+                 SOF_TIMESTAMPING_RAW_HARDWARE;
+
+    if (::setsockopt(descriptor_, SOL_SOCKET, SO_TIMESTAMPING,
+                     &flags, sizeof(flags)) < 0)
+        throw boost::system::system_error{
+                boost::system::error_code{errno,
+                                          boost::system::system_category()},
+                "setsockopt SO_TIMESTAMPING"};
+#else
+    throw std::runtime_error{"--timestamping is only supported on Linux"};
+#endif
+
+    send_user_to_qdisc_times_.initialize();
+    send_qdisc_to_driver_times_.initialize();
+    send_driver_to_wire_times_.initialize();
+    receive_wire_to_driver_times_.initialize();
+    receive_driver_to_user_times_.initialize();
+}
+
+void
+KernelTimestamps::finalize(Statistics & statistics)
+{
+    read_send_reports();
+
+    statistics.send_user_to_qdisc_times = send_user_to_qdisc_times_;
+    statistics.send_qdisc_to_driver_times = send_qdisc_to_driver_times_;
+    statistics.send_driver_to_wire_times = send_driver_to_wire_times_;
+    statistics.receive_wire_to_driver_times = receive_wire_to_driver_times_;
+    statistics.receive_driver_to_user_times = receive_driver_to_user_times_;
+}
+
+void
+KernelTimestamps::on_send(Clock::time_point start, std::size_t size)
+{
+    // A TCP send id is the offset of its last byte,
+    // a UDP one is the count of previous sends.
+    std::uint32_t id;
+    if (is_stream_)
+    {
+        next_id_ += std::uint32_t(size);
+        id = next_id_ - 1;
+    }
+    else
+        id = next_id_ ++;
+
+    pending_sends_.push_back(PendingSend{id, start, {}, {}, false});
+    if (pending_sends_.size() > MAX_PENDING_SENDS)
+        pending_sends_.pop_front();
+
+    read_send_reports();
+}
+
+void
+KernelTimestamps::read_send_reports()
+{
+#ifdef __linux__
+    for (;;)
+    {
+        char control[CMSG_SPACE(sizeof(scm_timestamping)) +
+                     CMSG_SPACE(sizeof(sock_extended_err) +
+                                sizeof(sockaddr_in6))];
+        msghdr message{};
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        if (::recvmsg(descriptor_, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // The error queue is drained.
+            break;
+        }
+
+        scm_timestamping timestamps{};
+        sock_extended_err error{};
+        for (cmsghdr * c = CMSG_FIRSTHDR(&message); c;
+                c = CMSG_NXTHDR(&message, c))
+        {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING)
+                std::memcpy(&timestamps, CMSG_DATA(c), sizeof(timestamps));
+            else if ((c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) ||
+                     (c->cmsg_level == SOL_IPV6 && c->cmsg_type == IPV6_RECVERR))
+                std::memcpy(&error, CMSG_DATA(c), sizeof(error));
+        }
+
+        if (error.ee_errno == ENOMSG &&
+                error.ee_origin == SO_EE_ORIGIN_TIMESTAMPING)
+            on_send_report(error.ee_data, error.ee_info,
+                           to_time_point(timestamps.ts[0]),
+                           to_time_point(timestamps.ts[2]));
+    }
+#endif
+}
+
+void
+KernelTimestamps::on_send_report(std::uint32_t id,
+                                 std::uint32_t stage,
+                                 Clock::time_point software,
+                                 Clock::time_point hardware)
+{
+#ifdef __linux__
+    auto i = pending_sends_.begin(), e = pending_sends_.end();
+    while (i != e && i->id != id)
+        ++ i;
+    if (i == e)
+        return;
+
+    Clock::time_point const none{};
+    if (stage == SCM_TSTAMP_SCHED && software != none)
+    {
+        i->scheduled = software;
+        record(send_user_to_qdisc_times_, i->start, software);
+    }
+    else if (stage == SCM_TSTAMP_SND && software != none)
+    {
+        i->sent = software;
+        if (i->scheduled != none)
+            record(send_qdisc_to_driver_times_, i->scheduled, software);
+        i->is_complete = ! is_hardware_;
+    }
+    else if (stage == SCM_TSTAMP_SND && hardware != none)
+    {
+        if (i->sent != none)
+            record(send_driver_to_wire_times_, i->sent, hardware);
+        i->is_complete = true;
+    }
+
+    // Reports are mostly received in order.
+    while (! pending_sends_.empty() && pending_sends_.front().is_complete)
+        pending_sends_.pop_front();
+#else
+    (void)id;
+    (void)stage;
+    (void)software;
+    (void)hardware;
+#endif
+}
+
+std::size_t
+KernelTimestamps::receive(const boost::asio::mutable_buffer & buffer,
+                          void * name,
+                          std::size_t & name_size,
+                          boost::system::error_code & failure)
+{
+#ifdef __linux__
+    iovec v{buffer.data(), buffer.size()};
+    char control[CMSG_SPACE(sizeof(scm_timestamping))];
+    msghdr message{};
+    message.msg_name = name;
+    message.msg_namelen = socklen_t(name_size);
+    message.msg_iov = &v;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t size;
+    do
+        size = ::recvmsg(descriptor_, &message, MSG_DONTWAIT);
+    while (size < 0 && errno == EINTR);
+    auto const now = Clock::now();
+
+    if (size < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            failure = boost::asio::error::would_block;
+        else
+            failure = boost::system::error_code{errno,
+                    boost::system::system_category()};
+        return 0;
+    }
+
+    if (size == 0 && is_stream_ && buffer.size() != 0)
+    {
+        failure = boost::asio::error::eof;
+        return 0;
+    }
+
+    name_size = message.msg_namelen;
+
+    for (cmsghdr * c = CMSG_FIRSTHDR(&message); c;
+            c = CMSG_NXTHDR(&message, c))
+    {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPING)
+            continue;
+
+        scm_timestamping timestamps;
+        std::memcpy(&timestamps, CMSG_DATA(c), sizeof(timestamps));
+
+        Clock::time_point const none{},
+                                software = to_time_point(timestamps.ts[0]),
+                                hardware = to_time_point(timestamps.ts[2]);
+        if (software != none)
+            record(receive_driver_to_user_times_, software, now);
+        if (software != none && hardware != none)
+            record(receive_wire_to_driver_times_, hardware, software);
+    }
+
+    return std::size_t(size);
+#else
+    (void)buffer;
+    (void)name;
+    (void)name_size;
+    failure = boost::asio::error::operation_not_supported;
+    return 0;
+#endif
+}
+
+void
+KernelTimestamps::record(Histogram & histogram,
+                         Clock::time_point start,
+                         Clock::time_point end)
+{
+    // The NIC and system clocks may be slightly off.
+    auto const duration = std::max(end - start, Clock::duration::zero());
+    histogram.record(std::uint64_t(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    duration).count()));
+}
+
+} // namespace net_tester
+} // namespace enyx
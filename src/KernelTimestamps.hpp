@@ -0,0 +1,230 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "Histogram.hpp"
+#include "SessionConfiguration.hpp"
+#include "Statistics.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+// Split the send and receive path latencies with the kernel
+// SO_TIMESTAMPING reports.
+//
+// Each send is timestamped when entering the qdisc (SCHED) and when
+// handed to the driver (SND), both reported on the socket error queue
+// with the send id. Each receive is timestamped when the driver hands
+// the packet to the stack, reported as ancillary data, hence received
+// with recvmsg(). With hardware timestamps, the NIC ones are compared
+// to the software ones, which requires the NIC clock to be synchronized
+// with the system one (e.g. with phc2sys).
+class KernelTimestamps
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+public:
+    // As the TCP send ids are bytes offsets, they can only
+    // be enabled on an established connection.
+    KernelTimestamps(boost::asio::io_service & io_service,
+                     int descriptor,
+                     bool is_stream,
+                     SessionConfiguration::Timestamping timestamping);
+
+    KernelTimestamps(const KernelTimestamps &) = delete;
+
+    // Wrap a send handler to assign the send its id.
+    template<typename Handler>
+    class Send
+    {
+    public:
+        using allocator_type = boost::asio::associated_allocator_t<Handler>;
+
+    public:
+        Send(KernelTimestamps & timestamps, Handler handler)
+            : timestamps_(timestamps),
+              start_(Clock::now()),
+              handler_(std::move(handler))
+        { }
+
+        allocator_type
+        get_allocator() const noexcept
+        {
+            return boost::asio::get_associated_allocator(handler_);
+        }
+
+        void
+        operator()(const boost::system::error_code & failure,
+                   std::size_t bytes_transferred)
+        {
+            if (! failure)
+                timestamps_.on_send(start_, bytes_transferred);
+
+            handler_(failure, bytes_transferred);
+        }
+
+    private:
+        KernelTimestamps & timestamps_;
+        Clock::time_point start_;
+        Handler handler_;
+    };
+
+    template<typename Handler>
+    Send<Handler>
+    wrap_send(Handler handler)
+    { return Send<Handler>{*this, std::move(handler)}; }
+
+    // Receive with recvmsg() once the socket is readable, the sender
+    // being stored into sender when not null.
+    template<typename Socket, typename Endpoint, typename ReadHandler>
+    void
+    async_receive(Socket & socket,
+                  const boost::asio::mutable_buffer & buffer,
+                  Endpoint * sender,
+                  ReadHandler handler)
+    {
+        // Try first to receive without waiting for the reactor.
+        boost::system::error_code failure;
+        std::size_t const size = receive(buffer, sender, failure);
+        if (failure == boost::asio::error::would_block)
+            async_wait_receive(socket, buffer, sender, std::move(handler));
+        else
+            io_service_.post([handler, failure, size]() mutable {
+                handler(failure, size);
+            });
+    }
+
+    // Read the pending reports and store the histograms into statistics.
+    void
+    finalize(Statistics & statistics);
+
+private:
+    // A send waiting for its reports.
+    struct PendingSend
+    {
+        std::uint32_t id;
+        Clock::time_point start;
+        Clock::time_point scheduled;
+        Clock::time_point sent;
+        bool is_complete;
+    };
+
+private:
+    void
+    on_send(Clock::time_point start, std::size_t size);
+
+    void
+    read_send_reports();
+
+    void
+    on_send_report(std::uint32_t id,
+                   std::uint32_t stage,
+                   Clock::time_point software,
+                   Clock::time_point hardware);
+
+    template<typename Socket, typename Endpoint, typename ReadHandler>
+    void
+    async_wait_receive(Socket & socket,
+                       const boost::asio::mutable_buffer & buffer,
+                       Endpoint * sender,
+                       ReadHandler handler)
+    {
+        socket.async_wait(Socket::wait_read,
+                [this, &socket, buffer, sender, handler]
+                (const boost::system::error_code & failure) mutable {
+            if (failure)
+            {
+                handler(failure, 0);
+                return;
+            }
+
+            boost::system::error_code f;
+            std::size_t const size = receive(buffer, sender, f);
+            if (f == boost::asio::error::would_block)
+                async_wait_receive(socket, buffer, sender, std::move(handler));
+            else
+                handler(f, size);
+        });
+    }
+
+    template<typename Endpoint>
+    std::size_t
+    receive(const boost::asio::mutable_buffer & buffer,
+            Endpoint * sender,
+            boost::system::error_code & failure)
+    {
+        std::size_t name_size = 0;
+        if (! sender)
+            return receive(buffer, nullptr, name_size, failure);
+
+
+        name_size = sender->capacity();
+        std::size_t const size = receive(buffer, sender->data(),
+                                         name_size, failure);
+        if (! failure)
+            sender->resize(name_size);
+        return size;
+    }
+
+    // Store the sender address size into name_size.
+    std::size_t
+    receive(const boost::asio::mutable_buffer & buffer,
+            void * name,
+            std::size_t & name_size,
+            boost::system::error_code & failure);
+
+    static void
+    record(Histogram & histogram,
+           Clock::time_point start,
+           Clock::time_point end);
+
+private:
+    boost::asio::io_service & io_service_;
+    int descriptor_;
+    bool is_stream_;
+    bool is_hardware_;
+    std::uint32_t next_id_;
+    std::deque<PendingSend> pending_sends_;
+    Histogram send_user_to_qdisc_times_;
+    Histogram send_qdisc_to_driver_times_;
+    Histogram send_driver_to_wire_times_;
+    Histogram receive_wire_to_driver_times_;
+    Histogram receive_driver_to_user_times_;
+};
+
+} // namespace net_tester
+} // namespace enyx
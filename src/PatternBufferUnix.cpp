@@ -0,0 +1,66 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "PatternBuffer.hpp"
+
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <system_error>
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+const std::uint8_t *
+create_pattern_buffer()
+{
+    void * memory = ::mmap(nullptr, PATTERN_BUFFER_SIZE,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        throw std::system_error{errno, std::generic_category()};
+
+    auto bytes = static_cast<std::uint8_t *>(memory);
+    for (std::size_t i = 0; i != PATTERN_BUFFER_SIZE; ++i)
+        bytes[i] = std::uint8_t(i);
+
+    // The mapping stays writable as the kernel pins the io_uring
+    // registered buffers for writing, the sessions only get a const
+    // pointer to it.
+    return bytes;
+}
+
+} // anonymous namespace
+
+const std::uint8_t *
+get_pattern_buffer()
+{
+    static const std::uint8_t * const buffer = create_pattern_buffer();
+    return buffer;
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,70 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "PatternBuffer.hpp"
+
+#include <windows.h>
+#include <memoryapi.h>
+#include <errhandlingapi.h>
+
+#include <system_error>
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+const std::uint8_t *
+create_pattern_buffer()
+{
+    void * memory = VirtualAlloc(nullptr, PATTERN_BUFFER_SIZE,
+                                 MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (! memory)
+        throw std::system_error{int(GetLastError()), std::system_category()};
+
+    auto bytes = static_cast<std::uint8_t *>(memory);
+    for (std::size_t i = 0; i != PATTERN_BUFFER_SIZE; ++i)
+        bytes[i] = std::uint8_t(i);
+
+    // Any write from a session is now a fault rather than
+    // a corruption of the other sessions data.
+    DWORD previous_protection;
+    if (! VirtualProtect(memory, PATTERN_BUFFER_SIZE,
+                         PAGE_READONLY, &previous_protection))
+        throw std::system_error{int(GetLastError()), std::system_category()};
+
+    return bytes;
+}
+
+} // anonymous namespace
+
+const std::uint8_t *
+get_pattern_buffer()
+{
+    static const std::uint8_t * const buffer = create_pattern_buffer();
+    return buffer;
+}
+
+} // namespace net_tester
+} // namespace enyx
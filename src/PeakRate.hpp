@@ -0,0 +1,90 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace enyx {
+namespace net_tester {
+
+// Largest bandwidth over a sampling period, which tells how bursty
+// a transfer is compared to its mean bandwidth.
+//
+// The periods start with the first transfer following the previous
+// period end, hence idle time isn't sampled.
+class PeakRate
+{
+public:
+    explicit
+    PeakRate(std::uint64_t sampling_frequency)
+        : sampling_frequency_(sampling_frequency),
+          period_duration_(std::chrono::nanoseconds(1000 * 1000 * 1000) /
+                           sampling_frequency),
+          period_end_(),
+          period_start_bytes_count_(),
+          last_bytes_count_(),
+          peak_bytes_count_()
+    { }
+
+    // Called with the total bytes count after each transfer.
+    void
+    update(std::uint64_t bytes_count)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        if (now >= period_end_)
+        {
+            peak_bytes_count_ = std::max(peak_bytes_count_,
+                                         last_bytes_count_ -
+                                         period_start_bytes_count_);
+            period_start_bytes_count_ = last_bytes_count_;
+            period_end_ = now + period_duration_;
+        }
+
+        last_bytes_count_ = bytes_count;
+    }
+
+    // Bytes per second.
+    std::uint64_t
+    get() const
+    {
+        return std::max(peak_bytes_count_,
+                        last_bytes_count_ - period_start_bytes_count_) *
+               sampling_frequency_;
+    }
+
+private:
+    std::uint64_t sampling_frequency_;
+    std::chrono::steady_clock::duration period_duration_;
+    std::chrono::steady_clock::time_point period_end_;
+    std::uint64_t period_start_bytes_count_;
+    std::uint64_t last_bytes_count_;
+    std::uint64_t peak_bytes_count_;
+};
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,88 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace enyx {
+namespace net_tester {
+
+// The cycles, instructions, cache misses, branch misses, page faults
+// and context switches of the calling thread counted with perf_event_open.
+//
+// The hardware events are counted in user mode only (noted with a ":u"
+// suffix) when the kernel ones are denied, and the cycles are replaced
+// by the software task_clock nanoseconds when the PMU is not accessible.
+// The events that can't be opened at all are omitted.
+//
+// The events are counted as a single group, hence they're scheduled on
+// the PMU together and their ratios (e.g. instructions per cycle) hold
+// even when the kernel multiplexes them with other events.
+class PerfCounters
+{
+public:
+    struct Counts
+    {
+        std::vector<std::pair<const char *, std::uint64_t>> values;
+        // Share of the time the group was counted, the values are
+        // scaled up to the whole time when below 1.
+        double running_ratio;
+    };
+
+public:
+    // Must be constructed, used and destroyed by the counted thread.
+    PerfCounters();
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+
+    PerfCounters &
+    operator=(const PerfCounters &) = delete;
+
+    void
+    start();
+
+    // Return the counts since start, without values when no event
+    // is available or the group was never counted.
+    Counts
+    stop();
+
+private:
+    struct Counter
+    {
+        const char * name;
+        int descriptor;
+    };
+
+private:
+    // The first one is the group leader.
+    std::vector<Counter> counters_;
+};
+
+} // namespace net_tester
+} // namespace enyx
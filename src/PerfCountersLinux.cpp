@@ -0,0 +1,183 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "PerfCounters.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+// The leader is opened disabled and reads the whole group, the other
+// counters follow it.
+int
+open_counter(std::uint32_t type, std::uint64_t config, bool is_user_only,
+             int leader)
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = type;
+    attributes.config = config;
+    attributes.disabled = leader < 0;
+    attributes.exclude_hv = 1;
+    attributes.exclude_kernel = is_user_only;
+    attributes.read_format = PERF_FORMAT_GROUP |
+                             PERF_FORMAT_TOTAL_TIME_ENABLED |
+                             PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return int(::syscall(SYS_perf_event_open, &attributes,
+                         0, -1, leader, 0));
+}
+
+} // anonymous namespace
+
+PerfCounters::PerfCounters()
+    : counters_()
+{
+    struct Event
+    {
+        const char * name;
+        const char * user_only_name;
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    static const Event hardware_events[] = {
+        {"cycles", "cycles:u",
+            PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", "instructions:u",
+            PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"cache_misses", "cache_misses:u",
+            PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {"branch_misses", "branch_misses:u",
+            PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+
+    auto const get_leader = [this] {
+        return counters_.empty() ? -1 : counters_.front().descriptor;
+    };
+
+    for (auto const& event : hardware_events)
+    {
+        int descriptor = open_counter(event.type, event.config, false,
+                                      get_leader());
+        const char * name = event.name;
+        if (descriptor < 0 && (errno == EACCES || errno == EPERM))
+        {
+            descriptor = open_counter(event.type, event.config, true,
+                                      get_leader());
+            name = event.user_only_name;
+        }
+
+        if (descriptor >= 0)
+            counters_.push_back(Counter{name, descriptor});
+        else if (event.config == PERF_COUNT_HW_CPU_CYCLES)
+        {
+            // The PMU is not accessible (e.g. in a virtual machine).
+            descriptor = open_counter(PERF_TYPE_SOFTWARE,
+                                      PERF_COUNT_SW_TASK_CLOCK, false,
+                                      get_leader());
+            if (descriptor >= 0)
+                counters_.push_back(Counter{"task_clock", descriptor});
+        }
+    }
+
+    static const Event software_events[] = {
+        {"page_faults", nullptr,
+            PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        {"context_switches", nullptr,
+            PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    };
+
+    for (auto const& event : software_events)
+    {
+        int descriptor = open_counter(event.type, event.config, false,
+                                      get_leader());
+        if (descriptor >= 0)
+            counters_.push_back(Counter{event.name, descriptor});
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (auto const& counter : counters_)
+        ::close(counter.descriptor);
+}
+
+void
+PerfCounters::start()
+{
+    if (counters_.empty())
+        return;
+
+    int const leader = counters_.front().descriptor;
+    ::ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::Counts
+PerfCounters::stop()
+{
+    Counts counts{{}, 0.};
+    if (counters_.empty())
+        return counts;
+
+    int const leader = counters_.front().descriptor;
+    ::ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // The PERF_FORMAT_GROUP layout: the counters count, the times
+    // enabled and running, then each counter value in opening order.
+    std::vector<std::uint64_t> group(3 + counters_.size());
+    auto const size = ssize_t(group.size() * sizeof(group[0]));
+    if (::read(leader, group.data(), std::size_t(size)) != size ||
+            group[0] != counters_.size())
+        return counts;
+
+    std::uint64_t const enabled = group[1], running = group[2];
+    if (! running)
+        return counts;
+
+    counts.running_ratio = double(running) / double(enabled);
+    for (std::size_t i = 0, e = counters_.size(); i != e; ++i)
+    {
+        std::uint64_t count = group[3 + i];
+        if (running < enabled)
+            count = std::uint64_t(double(count) / counts.running_ratio);
+        counts.values.emplace_back(counters_[i].name, count);
+    }
+
+    return counts;
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,58 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ReceiveGroup.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+ReceiveGroup::ReceiveGroup(std::uint64_t size)
+    : size_(size),
+      received_bytes_count_(),
+      members_()
+{ }
+
+void
+ReceiveGroup::join(OnComplete on_complete)
+{
+    members_.push_back(std::move(on_complete));
+}
+
+void
+ReceiveGroup::add(std::uint64_t bytes_count)
+{
+    if (! bytes_count)
+        return;
+
+    std::uint64_t const previous = received_bytes_count_.fetch_add(
+            bytes_count, std::memory_order_relaxed);
+
+    // Only the member crossing the size notifies the group.
+    if (previous < size_ && previous + bytes_count >= size_)
+        for (auto const& on_complete : members_)
+            on_complete();
+}
+
+} // namespace net_tester
+} // namespace enyx
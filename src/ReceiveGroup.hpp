@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace enyx {
+namespace net_tester {
+
+// Sessions listening on the same port with SO_REUSEPORT, usually run
+// by different threads. As the kernel spreads the peers over the
+// sockets, the sessions share the size to receive, and all of them
+// complete once the group received it.
+class ReceiveGroup
+{
+public:
+    using OnComplete = std::function<void()>;
+
+public:
+    explicit
+    ReceiveGroup(std::uint64_t size);
+
+    ReceiveGroup(const ReceiveGroup &) = delete;
+
+    // Members must join before the threads are started,
+    // on_complete is invoked from the thread completing the group.
+    void
+    join(OnComplete on_complete);
+
+    // Account the bytes received by a member, the members are
+    // notified when these bytes complete the group.
+    void
+    add(std::uint64_t bytes_count);
+
+    bool
+    is_complete() const noexcept
+    { return received_bytes_count_.load(std::memory_order_relaxed) >= size_; }
+
+private:
+    std::uint64_t size_;
+    std::atomic<std::uint64_t> received_bytes_count_;
+    std::vector<OnComplete> members_;
+};
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,170 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Reporter.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "Size.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+Size
+compute_bandwidth(std::uint64_t bytes_count,
+                  std::chrono::steady_clock::duration duration)
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+    if (ns.count() <= 0)
+        return Size{};
+
+    return Size(std::uint64_t(double(bytes_count) * 1e9 / double(ns.count())));
+}
+
+double
+to_seconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+} // anonymous namespace
+
+Reporter::Reporter(const Sessions & sessions,
+                   const Listeners & listeners,
+                   std::ostream & out)
+    : sessions_(sessions),
+      listeners_(listeners),
+      out_(out),
+      start_(std::chrono::steady_clock::now()),
+      last_(start_),
+      snapshots_(),
+      connections_snapshots_(listeners.size())
+{
+    for (auto const& session : sessions_)
+        snapshots_.push_back(take_snapshot(session->get_statistics()));
+}
+
+Reporter::Snapshot
+Reporter::take_snapshot(const Statistics & statistics)
+{
+    return Snapshot{statistics.received_bytes_count.load(),
+                    statistics.received_datagrams_count.load(),
+                    statistics.sent_bytes_count.load(),
+                    statistics.sent_datagrams_count.load(),
+                    statistics.received_sequences.evicted_lost_count()};
+}
+
+void
+Reporter::report()
+{
+    auto const now = std::chrono::steady_clock::now();
+    auto const duration = now - last_;
+
+    std::string interval;
+    {
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(3)
+          << "interval: " << to_seconds(last_ - start_)
+          << "-" << to_seconds(now - start_) << "s";
+        interval = s.str();
+    }
+
+    for (std::size_t i = 0, e = sessions_.size(); i != e; ++i)
+        report(interval + " session: " + std::to_string(i),
+               *sessions_[i], duration, snapshots_[i]);
+
+    for (std::size_t i = 0, e = listeners_.size(); i != e; ++i)
+    {
+        auto const connections = listeners_[i]->copy_sessions();
+        auto & snapshots = connections_snapshots_[i];
+        snapshots.resize(connections.size(), Snapshot{});
+
+        for (std::size_t j = 0, f = connections.size(); j != f; ++j)
+            report(interval + " listener: " + std::to_string(i) +
+                   " connection: " + std::to_string(j),
+                   *connections[j], duration, snapshots[j]);
+    }
+
+    out_ << std::flush;
+    last_ = now;
+}
+
+void
+Reporter::report(const std::string & prefix,
+                 const Session & session,
+                 std::chrono::steady_clock::duration duration,
+                 Snapshot & snapshot)
+{
+    Snapshot const current = take_snapshot(session.get_statistics());
+    Snapshot const & previous = snapshot;
+
+    std::uint64_t const received = current.received_bytes_count -
+                                   previous.received_bytes_count;
+    std::uint64_t const sent = current.sent_bytes_count -
+                               previous.sent_bytes_count;
+
+    auto const& configuration = session.get_configuration();
+    out_ << prefix
+         << " (" << configuration.endpoint << ")"
+         << " received_bytes_count: " << Size(received)
+         << " receive_bandwidth: "
+         << compute_bandwidth(received, duration) << "/s";
+
+    if (current.received_datagrams_count)
+        out_ << " received_datagrams_count: "
+             << current.received_datagrams_count -
+                previous.received_datagrams_count;
+
+    if (current.lost_datagrams_count)
+        out_ << " lost_datagrams_count: "
+             << current.lost_datagrams_count -
+                previous.lost_datagrams_count;
+
+    // The offered load of --tx-schedule.
+    if (! configuration.send_schedule.empty())
+        out_ << " send_target_bandwidth: "
+             << Size(session.get_statistics().send_target_bandwidth) << "/s";
+
+    out_ << " sent_bytes_count: " << Size(sent)
+         << " send_bandwidth: "
+         << compute_bandwidth(sent, duration) << "/s";
+
+    if (current.sent_datagrams_count)
+        out_ << " sent_datagrams_count: "
+             << current.sent_datagrams_count -
+                previous.sent_datagrams_count;
+
+    out_ << "\n";
+
+    snapshot = current;
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,95 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Session.hpp"
+#include "TcpListener.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+// Print at each interval one line per session, and per connection
+// accepted by the listeners, with the bytes and datagrams transferred
+// since the previous report.
+//
+// The reporter runs on the main thread only and reads the session
+// counters without synchronizing with the reactor threads.
+class Reporter
+{
+public:
+    using Sessions = std::vector<std::shared_ptr<Session>>;
+    using Listeners = std::vector<std::shared_ptr<TcpListener>>;
+
+public:
+    Reporter(const Sessions & sessions,
+             const Listeners & listeners,
+             std::ostream & out);
+
+    void
+    report();
+
+private:
+    struct Snapshot
+    {
+        std::uint64_t received_bytes_count;
+        std::uint64_t received_datagrams_count;
+        std::uint64_t sent_bytes_count;
+        std::uint64_t sent_datagrams_count;
+        std::uint64_t lost_datagrams_count;
+    };
+
+private:
+    static Snapshot
+    take_snapshot(const Statistics & statistics);
+
+    // Write the session line and update its snapshot.
+    void
+    report(const std::string & prefix,
+           const Session & session,
+           std::chrono::steady_clock::duration duration,
+           Snapshot & snapshot);
+
+private:
+    const Sessions & sessions_;
+    const Listeners & listeners_;
+    std::ostream & out_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point last_;
+    std::vector<Snapshot> snapshots_;
+    // Per listener, the connections accepted after the previous
+    // report start from zero.
+    std::vector<std::vector<Snapshot>> connections_snapshots_;
+};
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,294 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Results.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace enyx {
+namespace net_tester {
+
+namespace pt = boost::posix_time;
+
+namespace {
+
+std::uint64_t
+to_nanoseconds(const pt::time_duration & duration)
+{
+    if (duration.is_special() || duration.is_negative())
+        return 0;
+
+    return std::uint64_t(duration.total_nanoseconds());
+}
+
+// Count per second, unlike the text statistics not truncated
+// to milliseconds.
+std::uint64_t
+compute_rate(std::uint64_t bytes_count, const pt::time_duration & duration)
+{
+    std::uint64_t const nanoseconds = to_nanoseconds(duration);
+    if (nanoseconds == 0)
+        return 0;
+
+    return std::uint64_t(double(bytes_count) * 1e9 / double(nanoseconds));
+}
+
+void
+write_json_string(std::ostream & out, const std::string & s)
+{
+    out << '"';
+    for (char c : s)
+        switch (c)
+        {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        default:
+            if (std::uint8_t(c) < 0x20)
+            {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(c));
+                out << escaped;
+            }
+            else
+                out << c;
+        }
+    out << '"';
+}
+
+void
+write_csv_field(std::ostream & out, const std::string & s)
+{
+    if (s.find_first_of(",\"\n\r") == std::string::npos)
+    {
+        out << s;
+        return;
+    }
+
+    out << '"';
+    for (char c : s)
+    {
+        if (c == '"')
+            out << '"';
+        out << c;
+    }
+    out << '"';
+}
+
+} // anonymous namespace
+
+void
+Results::Record::add(const std::string & name, std::uint64_t value)
+{
+    metrics_.push_back(Metric{name, std::to_string(value), false});
+}
+
+void
+Results::Record::add(const std::string & name, double value)
+{
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(3) << value;
+    metrics_.push_back(Metric{name, s.str(), false});
+}
+
+void
+Results::Record::add(const std::string & name, const std::string & value)
+{
+    metrics_.push_back(Metric{name, value, true});
+}
+
+void
+Results::Record::add(const std::string & name, const Histogram & histogram)
+{
+    add(name + "_count", histogram.count());
+    add(name + "_min", histogram.min());
+    add(name + "_p50", histogram.count() ? histogram.percentile(50.) : 0);
+    add(name + "_p90", histogram.count() ? histogram.percentile(90.) : 0);
+    add(name + "_p99", histogram.count() ? histogram.percentile(99.) : 0);
+    add(name + "_p99_9", histogram.count() ? histogram.percentile(99.9) : 0);
+    add(name + "_max", histogram.max());
+}
+
+void
+Results::Record::add(const Statistics & statistics)
+{
+    add("start_date", statistics.start_date.is_special() ?
+            std::string{} : pt::to_iso_extended_string(statistics.start_date));
+    add("memory_bytes_count", statistics.memory_bytes_count);
+
+    add("received_bytes_count", statistics.received_bytes_count);
+    add("received_datagrams_count", statistics.received_datagrams_count);
+    add("receive_batches_count", statistics.receive_batch_sizes.batches_count);
+    add("receive_segments_batches_count",
+        statistics.receive_segments_counts.batches_count);
+    add("receive_segments_count",
+        statistics.receive_segments_counts.datagrams_count);
+    add("received_lost_count", statistics.received_sequences.lost_count());
+    add("received_reordered_count",
+        statistics.received_sequences.reordered_count());
+    add("received_duplicated_count",
+        statistics.received_sequences.duplicated_count());
+    add("received_late_count", statistics.received_sequences.late_count());
+    add("received_foreign_count",
+        statistics.received_sequences.foreign_count());
+    add("round_trip_times", statistics.round_trip_times);
+    add("transaction_rate", compute_rate(
+            statistics.round_trip_times.count(), statistics.receive_duration));
+    add("receive_wire_to_driver_times",
+        statistics.receive_wire_to_driver_times);
+    add("receive_driver_to_user_times",
+        statistics.receive_driver_to_user_times);
+    add("receive_duration", to_nanoseconds(statistics.receive_duration));
+    add("receive_target_bandwidth", statistics.receive_target_bandwidth);
+    add("receive_bandwidth", compute_rate(statistics.received_bytes_count,
+                                               statistics.receive_duration));
+    add("receive_peak_bandwidth", statistics.receive_peak_bandwidth);
+
+    add("sent_bytes_count", statistics.sent_bytes_count);
+    add("sent_datagrams_count", statistics.sent_datagrams_count);
+    add("send_batches_count", statistics.send_batch_sizes.batches_count);
+    add("send_segments_batches_count",
+        statistics.send_segments_counts.batches_count);
+    add("send_segments_count", statistics.send_segments_counts.datagrams_count);
+    add("sent_zerocopy_count", statistics.sent_zerocopy_count);
+    add("sent_copied_count", statistics.sent_copied_count);
+    add("send_target_datagram_rate", statistics.send_target_datagram_rate);
+    add("send_datagram_rate", compute_rate(statistics.sent_datagrams_count,
+                                                statistics.send_duration));
+    add("sent_datagram_gaps", statistics.sent_datagram_gaps);
+    add("sent_burst_sizes", statistics.sent_burst_sizes);
+    add("sent_burst_intervals", statistics.sent_burst_intervals);
+    add("send_user_to_qdisc_times", statistics.send_user_to_qdisc_times);
+    add("send_qdisc_to_driver_times", statistics.send_qdisc_to_driver_times);
+    add("send_driver_to_wire_times", statistics.send_driver_to_wire_times);
+    add("send_duration", to_nanoseconds(statistics.send_duration));
+    add("send_target_bandwidth", statistics.send_target_bandwidth);
+    add("send_bandwidth", compute_rate(statistics.sent_bytes_count,
+                                            statistics.send_duration));
+    add("send_peak_bandwidth", statistics.send_peak_bandwidth);
+}
+
+Results::Record &
+Results::add(const std::string & kind,
+             const std::string & endpoint,
+             const boost::system::error_code & status)
+{
+    records_.emplace_back();
+    Record & record = records_.back();
+
+    std::ostringstream s;
+    s << status;
+    record.add("kind", kind);
+    record.add("endpoint", endpoint);
+    record.add("status", s.str());
+    record.add("status_message", status.message());
+
+    return record;
+}
+
+void
+Results::write(std::ostream & out,
+               ApplicationConfiguration::OutputFormat format) const
+{
+    if (format == ApplicationConfiguration::JSON)
+        write_json(out);
+    else if (format == ApplicationConfiguration::CSV)
+        write_csv(out);
+
+    out << std::flush;
+}
+
+void
+Results::write_json(std::ostream & out) const
+{
+    // One record per line.
+    out << "[";
+    for (std::size_t i = 0, e = records_.size(); i != e; ++i)
+    {
+        out << (i ? ",\n " : "\n ") << "{";
+        auto const& metrics = records_[i].metrics_;
+        for (std::size_t j = 0, f = metrics.size(); j != f; ++j)
+        {
+            if (j)
+                out << ", ";
+            write_json_string(out, metrics[j].name);
+            out << ": ";
+            if (metrics[j].is_string)
+                write_json_string(out, metrics[j].value);
+            else
+                out << metrics[j].value;
+        }
+        out << "}";
+    }
+    out << "\n]\n";
+}
+
+void
+Results::write_csv(std::ostream & out) const
+{
+    // The records of different kinds don't share all their metrics,
+    // hence the columns are their union in order of appearance.
+    std::vector<std::string> columns;
+    for (auto const& record : records_)
+        for (auto const& metric : record.metrics_)
+            if (std::find(columns.begin(), columns.end(),
+                          metric.name) == columns.end())
+                columns.push_back(metric.name);
+
+    for (std::size_t i = 0, e = columns.size(); i != e; ++i)
+    {
+        if (i)
+            out << ",";
+        write_csv_field(out, columns[i]);
+    }
+    out << "\n";
+
+    for (auto const& record : records_)
+    {
+        for (std::size_t i = 0, e = columns.size(); i != e; ++i)
+        {
+            if (i)
+                out << ",";
+
+            auto const& metrics = record.metrics_;
+            auto metric = std::find_if(metrics.begin(), metrics.end(),
+                    [&](const Record::Metric & m) { return m.name == columns[i]; });
+            if (metric != metrics.end())
+                write_csv_field(out, metric->value);
+        }
+        out << "\n";
+    }
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,110 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/system/error_code.hpp>
+
+#include "ApplicationConfiguration.hpp"
+#include "Histogram.hpp"
+#include "Statistics.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+// Machine readable results written with --output-format=json|csv.
+//
+// Each record is a flat list of metrics, so that the JSON keys and the
+// CSV columns share the same names. Counts are exact integers, sizes are
+// in bytes, bandwidths in bytes per second and durations in nanoseconds.
+class Results
+{
+public:
+    class Record
+    {
+    public:
+        void
+        add(const std::string & name, std::uint64_t value);
+
+        // Written with 3 decimals, e.g. ratios.
+        void
+        add(const std::string & name, double value);
+
+        void
+        add(const std::string & name, const std::string & value);
+
+        // Add the count, min, p50, p90, p99, p99_9 and max of histogram
+        // as name_count, name_min...
+        void
+        add(const std::string & name, const Histogram & histogram);
+
+        // Add all the metrics of statistics.
+        void
+        add(const Statistics & statistics);
+
+    private:
+        friend class Results;
+
+        struct Metric
+        {
+            std::string name;
+            std::string value;
+            bool is_string;
+        };
+
+    private:
+        std::vector<Metric> metrics_;
+    };
+
+public:
+    // Start a record of the kind (e.g. "session", "total") for the
+    // endpoint, the reference is valid until the next record is added.
+    Record &
+    add(const std::string & kind,
+        const std::string & endpoint,
+        const boost::system::error_code & status);
+
+    void
+    write(std::ostream & out,
+          ApplicationConfiguration::OutputFormat format) const;
+
+private:
+    void
+    write_json(std::ostream & out) const;
+
+    void
+    write_csv(std::ostream & out) const;
+
+private:
+    std::vector<Record> records_;
+};
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,147 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Sequence.hpp"
+
+#include <iostream>
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+unsigned
+count_bits(std::uint64_t word)
+{
+#if defined(__GNUC__)
+    return unsigned(__builtin_popcountll(word));
+#else
+    unsigned count = 0;
+    for (; word; word &= word - 1)
+        ++ count;
+    return count;
+#endif
+}
+
+} // anonymous namespace
+
+SequenceTracker::SequenceTracker()
+    : window_(),
+      next_sequence_(),
+      received_count_(),
+      lost_count_(),
+      reordered_count_(),
+      duplicated_count_(),
+      late_count_(),
+      foreign_count_()
+{
+    // The sequences preceding the first one are considered received.
+    window_.fill(~std::uint64_t(0));
+}
+
+void
+SequenceTracker::add(std::uint64_t sequence)
+{
+    ++ received_count_;
+
+    if (sequence >= next_sequence_)
+    {
+        std::uint64_t const advance = sequence - next_sequence_ + 1;
+        if (advance >= WINDOW_SIZE)
+        {
+            // The whole window is left, as well as the sequences
+            // skipped before entering it.
+            lost_count_ += count_missing() + advance - WINDOW_SIZE;
+            window_.fill(0);
+        }
+        else
+            for (std::uint64_t s = next_sequence_; s != sequence + 1; ++s)
+            {
+                // Sequence s - WINDOW_SIZE leaves the window.
+                if (! test(s))
+                    ++ lost_count_;
+                reset(s);
+            }
+
+        set(sequence);
+        next_sequence_ = sequence + 1;
+    }
+    else if (next_sequence_ - sequence <= WINDOW_SIZE)
+    {
+        if (test(sequence))
+            ++ duplicated_count_;
+        else
+        {
+            ++ reordered_count_;
+            set(sequence);
+        }
+    }
+    else
+        ++ late_count_;
+}
+
+void
+SequenceTracker::merge(const SequenceTracker & other)
+{
+    received_count_ += other.received_count_;
+    lost_count_ += other.lost_count();
+    reordered_count_ += other.reordered_count_;
+    duplicated_count_ += other.duplicated_count_;
+    late_count_ += other.late_count_;
+    foreign_count_ += other.foreign_count_;
+}
+
+std::uint64_t
+SequenceTracker::count_missing() const
+{
+    std::uint64_t missing = 0;
+    for (auto word : window_)
+        missing += WORD_BITS - count_bits(word);
+    return missing;
+}
+
+std::uint64_t
+SequenceTracker::lost_count() const
+{
+    return lost_count_ + count_missing();
+}
+
+std::ostream &
+operator<<(std::ostream & out, const SequenceTracker & tracker)
+{
+    std::ostream::sentry sentry(out);
+
+    if (sentry)
+        out << "lost " << tracker.lost_count()
+            << ", reordered " << tracker.reordered_count()
+            << ", duplicated " << tracker.duplicated_count()
+            << ", late " << tracker.late_count()
+            << ", foreign " << tracker.foreign_count();
+
+    return out;
+}
+
+} // namespace net_tester
+} // namespace enyx
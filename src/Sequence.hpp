@@ -0,0 +1,159 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+#include "Counter.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+// Header prepended to each datagram with --sequence-header.
+// Fields are stored in host byte order.
+struct SequenceHeader
+{
+    enum { SIZE = 24 };
+
+    std::uint64_t sequence;
+    std::uint32_t session_id;
+    std::uint32_t reserved;
+    // steady_clock time of the send, in nanoseconds.
+    std::uint64_t timestamp;
+};
+
+static_assert(sizeof(SequenceHeader) == SequenceHeader::SIZE,
+              "SequenceHeader must not be padded");
+
+// Track the received sequence numbers of a datagram flow
+// within a sliding window of WINDOW_SIZE sequences:
+//   - a sequence leaving the window without being received is lost,
+//   - a sequence received after a greater one is reordered,
+//   - a sequence received twice within the window is duplicated,
+//   - a sequence received after leaving the window is late
+//     (and had already been counted as lost).
+//
+// The window is a fixed size bitmap, hence add() never allocates.
+class SequenceTracker
+{
+public:
+    enum { WINDOW_SIZE = 4096 };
+
+public:
+    SequenceTracker();
+
+    void
+    add(std::uint64_t sequence);
+
+    // Count a datagram sent by another session.
+    void
+    add_foreign()
+    { ++ foreign_count_; }
+
+    // Add the counts of other, the sequences missing from its
+    // window being lost.
+    void
+    merge(const SequenceTracker & other);
+
+    bool
+    is_empty() const
+    { return ! received_count_ && ! foreign_count_; }
+
+    // Include the sequences missing from the current window.
+    std::uint64_t
+    lost_count() const;
+
+    // Only the sequences which left the window, hence it can
+    // be read by another thread.
+    std::uint64_t
+    evicted_lost_count() const
+    { return lost_count_; }
+
+    std::uint64_t
+    reordered_count() const
+    { return reordered_count_; }
+
+    std::uint64_t
+    duplicated_count() const
+    { return duplicated_count_; }
+
+    std::uint64_t
+    late_count() const
+    { return late_count_; }
+
+    std::uint64_t
+    foreign_count() const
+    { return foreign_count_; }
+
+private:
+    enum { WORD_BITS = 64, WORDS_COUNT = WINDOW_SIZE / WORD_BITS };
+
+private:
+    bool
+    test(std::uint64_t sequence) const
+    {
+        std::size_t bit = sequence % WINDOW_SIZE;
+        return window_[bit / WORD_BITS] >> (bit % WORD_BITS) & 1;
+    }
+
+    void
+    set(std::uint64_t sequence)
+    {
+        std::size_t bit = sequence % WINDOW_SIZE;
+        window_[bit / WORD_BITS] |= std::uint64_t(1) << (bit % WORD_BITS);
+    }
+
+    void
+    reset(std::uint64_t sequence)
+    {
+        std::size_t bit = sequence % WINDOW_SIZE;
+        window_[bit / WORD_BITS] &= ~(std::uint64_t(1) << (bit % WORD_BITS));
+    }
+
+    std::uint64_t
+    count_missing() const;
+
+private:
+    // Bit s % WINDOW_SIZE is set when sequence s of the window
+    // [next_sequence_ - WINDOW_SIZE, next_sequence_) has been received.
+    std::array<std::uint64_t, WORDS_COUNT> window_;
+    std::uint64_t next_sequence_;
+    std::uint64_t received_count_;
+    Counter lost_count_;
+    std::uint64_t reordered_count_;
+    std::uint64_t duplicated_count_;
+    std::uint64_t late_count_;
+    std::uint64_t foreign_count_;
+};
+
+std::ostream &
+operator<<(std::ostream & out, const SequenceTracker & tracker);
+
+} // namespace net_tester
+} // namespace enyx
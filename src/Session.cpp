@@ -33,6 +33,8 @@
 
 #include "Error.hpp"
 #include "Signal.hpp"
+#include "IoUring.hpp"
+#include "Verify.hpp"
 
 namespace enyx {
 namespace net_tester {
@@ -40,6 +42,14 @@ namespace net_tester {
 namespace ao = boost::asio;
 namespace pt = boost::posix_time;
 
+namespace {
+
+// Upper bound of a ping or pong round trip, used to estimate
+// the duration of these workloads as they ignore the bandwidth.
+const pt::time_duration ROUND_TRIP_TIMEOUT = pt::milliseconds(1);
+
+} // anonymous namespace
+
 Session::Session(boost::asio::io_service & io_service,
                  const SessionConfiguration & configuration)
     : io_service_(io_service),
@@ -52,17 +62,61 @@ Session::Session(boost::asio::io_service & io_service,
       timeout_timer_(io_service),
       statistics_(),
       failure_(),
-      send_buffer_(BUFFER_SIZE),
+      send_buffer_(get_pattern_buffer()),
+      // With --tx-rate, the send slices count datagrams.
       send_throttle_(io_service,
-                     configuration.send_bandwidth,
-                     configuration.bandwidth_sampling_frequency),
-      receive_buffer_(BUFFER_SIZE),
+                     configuration.send_rate ?
+                     configuration.send_rate :
+                     std::uint64_t(configuration.send_bandwidth),
+                     configuration.bandwidth_sampling_frequency,
+                     configuration.burst),
+      send_peak_rate_(configuration.bandwidth_sampling_frequency),
+      // Only the receiving sessions need a buffer.
+      receive_buffer_(configuration.direction != SessionConfiguration::TX ?
+                      BUFFER_SIZE : 0),
       receive_throttle_(io_service,
                         configuration.receive_bandwidth,
-                        configuration.bandwidth_sampling_frequency),
+                        configuration.bandwidth_sampling_frequency,
+                        configuration.burst),
+      receive_peak_rate_(configuration.bandwidth_sampling_frequency),
       is_receive_complete_(),
-      is_send_complete_()
+      is_send_complete_(),
+      round_trip_start_(),
+      pending_requests_(),
+      is_sending_message_(),
+      is_receiving_message_()
 {
+    // The bandwidth limits only throttle the stream workload.
+    if (configuration.workload == SessionConfiguration::STREAM)
+    {
+        if (configuration.direction != SessionConfiguration::TX)
+            statistics_.receive_target_bandwidth = configuration.receive_bandwidth;
+        if (configuration.direction != SessionConfiguration::RX)
+        {
+            if (configuration.send_rate)
+                statistics_.send_target_datagram_rate = configuration.send_rate;
+            else if (! configuration.send_schedule.empty())
+                statistics_.send_target_bandwidth = std::uint64_t(
+                        configuration.send_schedule.get_bandwidth(0.));
+            else
+                statistics_.send_target_bandwidth =
+                        std::uint64_t(configuration.send_bandwidth);
+        }
+    }
+
+    if (configuration.pacing == SessionConfiguration::KERNEL)
+        send_throttle_.disable();
+
+    if (! configuration.send_schedule.empty())
+        send_throttle_.set_schedule(configuration.send_schedule,
+                                    statistics_.send_target_bandwidth);
+
+    if (configuration.arrival != SessionConfiguration::UNIFORM)
+        send_throttle_.set_arrival(configuration.arrival,
+                                   configuration.arrival_burst,
+                                   std::chrono::microseconds(
+                                       configuration.arrival_gap
+                                           .total_microseconds()));
 }
 
 void
@@ -90,8 +144,23 @@ Session::initialize()
 
     signals_.async_wait(handler);
 
-    for (std::size_t i = 0, e = send_buffer_.size(); i != e; ++i)
-        send_buffer_[i] = uint8_t(i);
+    if (configuration_.workload == SessionConfiguration::PING)
+        statistics_.round_trip_times.initialize();
+
+    if (configuration_.send_rate)
+        statistics_.sent_datagram_gaps.initialize();
+
+    if (configuration_.engine == SessionConfiguration::IO_URING)
+    {
+        // Buffers are registered once to use fixed buffers operations,
+        // the shared send pattern once per ring.
+        auto & ring = ao::use_service<IoUring>(io_service_);
+        if (! receive_buffer_.empty())
+            ring.register_buffer(receive_buffer_.data(), receive_buffer_.size());
+        if (configuration_.direction != SessionConfiguration::RX ||
+                configuration_.workload != SessionConfiguration::STREAM)
+            ring.register_buffer(send_buffer_, BUFFER_SIZE);
+    }
 }
 
 void
@@ -99,6 +168,9 @@ Session::start_transfer()
 {
     statistics_.start_date = pt::microsec_clock::universal_time();
 
+    if (configuration_.workload != SessionConfiguration::STREAM)
+        return next_round_trip();
+
     if (configuration_.direction == SessionConfiguration::TX)
         finish_receive();
     else
@@ -132,19 +204,27 @@ Session::start_timer()
 boost::system::error_code
 Session::finalize()
 {
+    statistics_.memory_bytes_count = get_memory_size();
+
     std::cout << statistics_ << std::endl;
     std::cout << "status: " << failure_ << std::endl;
 
     return failure_;
 }
 
+std::size_t
+Session::get_memory_size() const
+{
+    return sizeof(Session) + receive_buffer_.capacity();
+}
+
 pt::time_duration
 Session::estimate_test_duration(const SessionConfiguration & configuration)
 {
-    uint64_t bandwidth = std::min(configuration.receive_bandwidth,
-                                  configuration.send_bandwidth);
-
-    pt::time_duration duration = pt::seconds(configuration.size / bandwidth + 1);
+    pt::time_duration duration = configuration.workload ==
+                                 SessionConfiguration::STREAM ?
+            estimate_stream_duration(configuration) :
+            estimate_round_trips_duration(configuration);
 
     auto duration_margin = configuration.duration_margin;
     if (duration_margin.is_special())
@@ -153,6 +233,48 @@ Session::estimate_test_duration(const SessionConfiguration & configuration)
     return duration + duration_margin;
 }
 
+pt::time_duration
+Session::estimate_round_trips_duration(const SessionConfiguration & configuration)
+{
+    std::uint64_t const message_size = std::max<std::uint64_t>(
+            configuration.message_size, 1);
+    std::uint64_t const round_trips = (configuration.size + message_size - 1) /
+                                      message_size;
+
+    return pt::seconds(1) + pt::microseconds(
+            ROUND_TRIP_TIMEOUT.total_microseconds() * std::int64_t(round_trips));
+}
+
+pt::time_duration
+Session::estimate_stream_duration(const SessionConfiguration & configuration)
+{
+    // With --tx-rate, assume the smallest datagrams are sent.
+    uint64_t send_bandwidth = configuration.send_rate ?
+            configuration.send_rate * configuration.packet_size.low() :
+            uint64_t(configuration.send_bandwidth);
+
+    // The bursts are separated by idle periods.
+    double const burst = double(configuration.arrival_burst),
+                 gap = double(configuration.arrival_gap.total_microseconds()) /
+                       1e6;
+    if (configuration.arrival == SessionConfiguration::ON_OFF)
+        send_bandwidth = uint64_t(burst / (burst / double(send_bandwidth) +
+                                           gap));
+    else if (configuration.arrival == SessionConfiguration::MICROBURST)
+        send_bandwidth = uint64_t(burst / gap);
+
+    // The schedule averages its bandwidths over the transfer.
+    if (! configuration.send_schedule.empty())
+        send_bandwidth = uint64_t(double(configuration.size) /
+                std::max(configuration.send_schedule.estimate_duration(
+                                configuration.size), 1.));
+    send_bandwidth = std::max(send_bandwidth, uint64_t(1));
+    uint64_t bandwidth = std::min(uint64_t(configuration.receive_bandwidth),
+                                  send_bandwidth);
+
+    return pt::seconds(configuration.size / bandwidth + 1);
+}
+
 void
 Session::on_receive(const boost::system::error_code & failure,
                     std::size_t bytes_transferred,
@@ -167,22 +289,35 @@ Session::on_receive(const boost::system::error_code & failure,
         abort(failure);
     else
     {
-        verify(bytes_transferred);
-        statistics_.received_bytes_count += bytes_transferred;
-
-        std::size_t size = slice_remaining_size - bytes_transferred;
-        if (statistics_.received_bytes_count < configuration_.size)
-            async_receive(size);
-        else
-            finish_receive();
+        process_received(receive_buffer_.data(), bytes_transferred);
+        receive_next(slice_remaining_size - bytes_transferred);
     }
 }
 
+void
+Session::process_received(const std::uint8_t * data, std::size_t size)
+{
+    verify(data, size);
+    statistics_.received_bytes_count += size;
+}
+
+void
+Session::receive_next(std::size_t slice_remaining_size)
+{
+    receive_peak_rate_.update(statistics_.received_bytes_count);
+
+    if (statistics_.received_bytes_count < configuration_.size)
+        async_receive(slice_remaining_size);
+    else
+        finish_receive();
+}
+
 void
 Session::finish_receive()
 {
     statistics_.receive_duration = pt::microsec_clock::universal_time() -
                                    statistics_.start_date;
+    statistics_.receive_peak_bandwidth = receive_peak_rate_.get();
 }
 
 void
@@ -195,7 +330,7 @@ Session::on_receive_complete()
 }
 
 void
-Session::verify(std::size_t bytes_transferred)
+Session::verify(const std::uint8_t * data, std::size_t size)
 {
     uint8_t expected_byte = uint8_t(statistics_.received_bytes_count);
 
@@ -205,19 +340,27 @@ Session::verify(std::size_t bytes_transferred)
     case SessionConfiguration::NONE:
         break;
     case SessionConfiguration::FIRST:
-        verify(0, expected_byte);
+        if (size)
+            verify(data, 0, expected_byte);
         break;
     case SessionConfiguration::ALL:
-        for (std::size_t i = 0; i != bytes_transferred; ++i)
-            verify(i, expected_byte++);
+        {
+            // Compare whole vectors, only the mismatching byte
+            // is reported.
+            std::size_t i = find_pattern_mismatch(data, size, expected_byte);
+            if (i != size)
+                verify(data, i, uint8_t(expected_byte + i));
+        }
         break;
     }
 }
 
 void
-Session::verify(std::size_t offset, uint8_t expected_byte)
+Session::verify(const std::uint8_t * data,
+                std::size_t offset,
+                uint8_t expected_byte)
 {
-    uint8_t actual = receive_buffer_[offset];
+    uint8_t actual = data[offset];
     if (actual != expected_byte)
     {
         std::cerr << "Data byte "
@@ -233,7 +376,8 @@ Session::verify(std::size_t offset, uint8_t expected_byte)
 void
 Session::on_send(const boost::system::error_code & failure,
                  std::size_t bytes_transferred,
-                 std::size_t slice_remaining_size)
+                 std::size_t slice_remaining_size,
+                 std::size_t datagrams_count)
 {
     if (failure == ao::error::operation_aborted)
         return;
@@ -243,7 +387,12 @@ Session::on_send(const boost::system::error_code & failure,
     else
     {
         statistics_.sent_bytes_count += bytes_transferred;
-        std::size_t size = slice_remaining_size - bytes_transferred;
+        send_peak_rate_.update(statistics_.sent_bytes_count);
+        // A datagram is sent whole, even if it overflows the slice.
+        std::size_t const cost = configuration_.send_rate ?
+                                 datagrams_count : bytes_transferred;
+        std::size_t size = slice_remaining_size -
+                           std::min(cost, slice_remaining_size);
         if (statistics_.sent_bytes_count < configuration_.size)
             async_send(size);
         else
@@ -256,6 +405,11 @@ Session::finish_send()
 {
     statistics_.send_duration = pt::microsec_clock::universal_time() -
                                 statistics_.start_date;
+    statistics_.send_peak_bandwidth = send_peak_rate_.get();
+
+    if (configuration_.arrival != SessionConfiguration::UNIFORM)
+        send_throttle_.get_bursts(statistics_.sent_burst_sizes,
+                                  statistics_.sent_burst_intervals);
 }
 
 void
@@ -267,6 +421,132 @@ Session::on_send_complete()
         on_finish();
 }
 
+void
+Session::next_round_trip()
+{
+    // Ping keeps up to --pipeline-depth requests in flight,
+    // pong waits for a request to answer it.
+    if (configuration_.workload == SessionConfiguration::PING)
+    {
+        send_next_request();
+        receive_next_response();
+
+        if (statistics_.sent_bytes_count == configuration_.size &&
+                ! is_sending_message_ && ! is_receiving_message_)
+        {
+            finish_send();
+            finish_receive();
+        }
+        return;
+    }
+
+    std::size_t const remaining_size = configuration_.size -
+                                       statistics_.received_bytes_count;
+    if (remaining_size == 0)
+    {
+        finish_send();
+        finish_receive();
+        return;
+    }
+
+    async_receive_message(std::min<std::size_t>(configuration_.message_size,
+                                                 remaining_size));
+}
+
+void
+Session::send_next_request()
+{
+    std::size_t const remaining_size = configuration_.size -
+                                       statistics_.sent_bytes_count;
+    if (is_sending_message_ || remaining_size == 0 ||
+            pending_requests_.size() == configuration_.pipeline_depth)
+        return;
+
+    std::size_t const size = std::min<std::size_t>(configuration_.message_size,
+                                                   remaining_size);
+    std::size_t const offset = std::uint8_t(statistics_.sent_bytes_count);
+    is_sending_message_ = true;
+    round_trip_start_ = std::chrono::steady_clock::now();
+    async_send_message(&send_buffer_[offset], size);
+}
+
+void
+Session::receive_next_response()
+{
+    if (is_receiving_message_ || pending_requests_.empty())
+        return;
+
+    is_receiving_message_ = true;
+    async_receive_message(pending_requests_.front().response_size);
+}
+
+void
+Session::on_message_sent(const boost::system::error_code & failure,
+                         std::size_t bytes_transferred)
+{
+    if (failure == ao::error::operation_aborted)
+        return;
+
+    if (failure)
+        abort(failure);
+    else
+    {
+        statistics_.sent_bytes_count += bytes_transferred;
+        if (configuration_.workload == SessionConfiguration::PING)
+        {
+            // The request is only pending once sent, hence its
+            // response can't be received before.
+            is_sending_message_ = false;
+            std::size_t const response_size = configuration_.response_size ?
+                    std::size_t(configuration_.response_size) :
+                    bytes_transferred;
+            pending_requests_.push_back({round_trip_start_, response_size});
+        }
+        next_round_trip();
+    }
+}
+
+void
+Session::on_message_received(const boost::system::error_code & failure,
+                             std::size_t bytes_transferred)
+{
+    if (failure == ao::error::operation_aborted)
+        return;
+
+    if (failure == ao::error::eof)
+        abort(error::unexpected_eof);
+    else if (failure)
+        abort(failure);
+    else if (configuration_.workload == SessionConfiguration::PING)
+    {
+        auto const round_trip_time = std::chrono::steady_clock::now() -
+                                     pending_requests_.front().start;
+        statistics_.round_trip_times.record(std::uint64_t(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        round_trip_time).count()));
+        pending_requests_.pop_front();
+        is_receiving_message_ = false;
+
+        process_received(receive_buffer_.data(), bytes_transferred);
+        next_round_trip();
+    }
+    else
+    {
+        process_received(receive_buffer_.data(), bytes_transferred);
+
+        // Without --response-size, the request is echoed.
+        if (configuration_.response_size)
+        {
+            std::size_t const offset = std::uint8_t(
+                    statistics_.sent_bytes_count);
+            async_send_message(&send_buffer_[offset],
+                               configuration_.response_size);
+        }
+        else
+            async_send_message(receive_buffer_.data(), bytes_transferred);
+    }
+}
+
 void
 Session::abort(const boost::system::error_code & failure)
 {
@@ -25,7 +25,9 @@
 #pragma once
 
 #include <cstddef>
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <random>
 #include <vector>
@@ -36,7 +38,9 @@
 
 #include "SessionConfiguration.hpp"
 #include "BandwidthThrottle.hpp"
+#include "PeakRate.hpp"
 #include "Statistics.hpp"
+#include "PatternBuffer.hpp"
 
 namespace enyx {
 namespace net_tester {
@@ -54,12 +58,32 @@ public:
     boost::system::error_code
     finalize();
 
+    const Statistics &
+    get_statistics() const
+    { return statistics_; }
+
+    const SessionConfiguration &
+    get_configuration() const
+    { return configuration_; }
+
+    const boost::system::error_code &
+    get_failure() const
+    { return failure_; }
+
+    boost::asio::io_service &
+    get_io_service() const
+    { return io_service_; }
+
+    // Time allowed to a session to complete before a timeout.
+    static boost::posix_time::time_duration
+    estimate_test_duration(const SessionConfiguration & configuration);
+
 private:
     using buffer_type = std::vector<std::uint8_t>;
 
 
 protected:
-    enum { BUFFER_SIZE = 128 << 10 };
+    enum { BUFFER_SIZE = PATTERN_BUFFER_SIZE };
 
 protected:
 
@@ -74,6 +98,12 @@ protected:
                std::size_t bytes_transferred,
                std::size_t slice_remaining_size);
 
+    virtual void
+    process_received(const std::uint8_t * data, std::size_t size);
+
+    void
+    receive_next(std::size_t slice_remaining_size);
+
     virtual void
     finish_receive();
 
@@ -89,22 +119,56 @@ protected:
     virtual void
     async_send(std::size_t slice_remaining_size = 0ULL) = 0;
 
+    // The slice is consumed by the bytes transferred, or with
+    // --tx-rate by the datagrams count.
     void
     on_send(const boost::system::error_code & failure,
             std::size_t bytes_transferred,
-            std::size_t slice_remaining_size);
+            std::size_t slice_remaining_size,
+            std::size_t datagrams_count = 1);
 
     virtual void
     finish_send();
 
+    // Send the whole message, then invoke on_message_sent().
+    virtual void
+    async_send_message(const std::uint8_t * data, std::size_t size) = 0;
+
+    // Receive a whole message into the receive buffer,
+    // then invoke on_message_received().
+    virtual void
+    async_receive_message(std::size_t size) = 0;
+
+    void
+    next_round_trip();
+
+    // Ping sends requests while less than --pipeline-depth are
+    // waiting for their response.
+    void
+    send_next_request();
+
+    // Ping receives the response of the oldest request.
+    void
+    receive_next_response();
+
+    void
+    on_message_sent(const boost::system::error_code & failure,
+                    std::size_t bytes_transferred);
+
+    void
+    on_message_received(const boost::system::error_code & failure,
+                        std::size_t bytes_transferred);
+
     void
     on_send_complete();
 
     void
-    verify(std::size_t bytes_transferred);
+    verify(const std::uint8_t * data, std::size_t size);
 
     void
-    verify(std::size_t offset, uint8_t expected_byte);
+    verify(const std::uint8_t * data,
+           std::size_t offset,
+           uint8_t expected_byte);
 
     void
     abort(const boost::system::error_code & failure);
@@ -115,8 +179,16 @@ protected:
     virtual void
     finish() = 0;
 
+    // Memory owned by the session, the shared send pattern excluded.
+    virtual std::size_t
+    get_memory_size() const;
+
+private:
     static boost::posix_time::time_duration
-    estimate_test_duration(const SessionConfiguration & configuration);
+    estimate_stream_duration(const SessionConfiguration & configuration);
+
+    static boost::posix_time::time_duration
+    estimate_round_trips_duration(const SessionConfiguration & configuration);
 
 protected:
     boost::asio::io_service & io_service_;
@@ -125,12 +197,24 @@ protected:
     boost::asio::deadline_timer timeout_timer_;
     Statistics statistics_;
     boost::system::error_code failure_;
-    buffer_type send_buffer_;
+    const std::uint8_t * send_buffer_;
     BandwidthThrottle send_throttle_;
+    PeakRate send_peak_rate_;
     buffer_type receive_buffer_;
     BandwidthThrottle receive_throttle_;
+    PeakRate receive_peak_rate_;
     bool is_receive_complete_;
     bool is_send_complete_;
+    struct PendingRequest
+    {
+        std::chrono::steady_clock::time_point start;
+        std::size_t response_size;
+    };
+
+    std::chrono::steady_clock::time_point round_trip_start_;
+    std::deque<PendingRequest> pending_requests_;
+    bool is_sending_message_;
+    bool is_receiving_message_;
 };
 
 } // namespace net_tester
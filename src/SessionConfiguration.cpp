@@ -149,10 +149,22 @@ operator<<(std::ostream & out, const SessionConfiguration & configuration)
         out << "endpoint: " << configuration.endpoint << "\n";
         out << "send_bandwidth: "
             << configuration.send_bandwidth << "/s\n";
+        if (! configuration.send_schedule.empty())
+            out << "send_schedule: " << configuration.send_schedule << "\n";
+        if (configuration.send_rate)
+            out << "send_rate: " << configuration.send_rate << "pps\n";
         out << "receive_bandwidth: "
             << configuration.receive_bandwidth << "/s\n";
         out << "bandwidth_sampling_frequency: "
             << configuration.bandwidth_sampling_frequency << "Hz\n";
+        if (configuration.burst != 0)
+            out << "burst: " << configuration.burst << "\n";
+        out << "pacing: " << configuration.pacing << "\n";
+        out << "arrival: " << configuration.arrival << "\n";
+        if (configuration.arrival == SessionConfiguration::ON_OFF ||
+                configuration.arrival == SessionConfiguration::MICROBURST)
+            out << "arrival_burst: " << configuration.arrival_burst << "\n"
+                << "arrival_gap: " << configuration.arrival_gap << "\n";
         out << "verify: " << configuration.verify << "\n";
         if (configuration.windows != 0)
             out << "windows: " << configuration.windows << "\n";
@@ -166,6 +178,31 @@ operator<<(std::ostream & out, const SessionConfiguration & configuration)
                 << configuration.duration_margin << "\n";
         out << "shutdown_policy: "
             << configuration.shutdown_policy << "\n";
+        out << "engine: " << configuration.engine << "\n";
+        out << "batch_size: " << configuration.batch_size << "\n";
+        out << "offload: " << configuration.offload << "\n";
+        out << "zerocopy: " << std::boolalpha << configuration.zerocopy
+            << std::noboolalpha << "\n";
+        out << "timestamping: " << configuration.timestamping << "\n";
+        out << "workload: " << configuration.workload << "\n";
+        out << "message_size: " << configuration.message_size << "\n";
+        out << "response_size: " << configuration.response_size << "\n";
+        out << "pipeline_depth: " << configuration.pipeline_depth << "\n";
+        out << "sequence_header: " << std::boolalpha
+            << configuration.sequence_header << std::noboolalpha << "\n";
+        if (configuration.reuse_port)
+            out << "reuse_port: " << configuration.reuse_port << "\n";
+        if (configuration.announce)
+            out << "announce: true\n";
+        if (configuration.connections)
+            out << "connections: " << configuration.connections << "\n"
+                << "cpu_steering: " << std::boolalpha
+                << configuration.cpu_steering << std::noboolalpha << "\n";
+        if (configuration.workload == SessionConfiguration::CHURN)
+            out << "churn_rate: " << configuration.churn_rate << "/s\n"
+                << "churn_concurrency: "
+                << configuration.churn_concurrency << "\n"
+                << "churn_timeout: " << configuration.churn_timeout << "\n";
         out << std::flush;
     }
 
@@ -254,6 +291,269 @@ operator<<(std::ostream & out, const SessionConfiguration::Protocol & protocol)
     }
 }
 
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Engine & engine)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        if (s == "asio")
+            engine = SessionConfiguration::ASIO;
+        else if (s == "io_uring")
+            engine = SessionConfiguration::IO_URING;
+        else
+            throw std::runtime_error("Unexpected engine");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Engine & engine)
+{
+    std::ostream::sentry sentry(out);
+
+    if (! sentry)
+        return out;
+
+    switch (engine)
+    {
+    default:
+    case SessionConfiguration::ASIO:
+        return out << "asio";
+    case SessionConfiguration::IO_URING:
+        return out << "io_uring";
+    }
+}
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Offload & offload)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        if (s == "none")
+            offload = SessionConfiguration::NO_OFFLOAD;
+        else if (s == "gso")
+            offload = SessionConfiguration::GSO;
+        else if (s == "gro")
+            offload = SessionConfiguration::GRO;
+        else if (s == "both")
+            offload = SessionConfiguration::GSO_GRO;
+        else
+            throw std::runtime_error("Unexpected offload");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Offload & offload)
+{
+    std::ostream::sentry sentry(out);
+
+    if (! sentry)
+        return out;
+
+    switch (offload)
+    {
+    default:
+    case SessionConfiguration::NO_OFFLOAD:
+        return out << "none";
+    case SessionConfiguration::GSO:
+        return out << "gso";
+    case SessionConfiguration::GRO:
+        return out << "gro";
+    case SessionConfiguration::GSO_GRO:
+        return out << "both";
+    }
+}
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Workload & workload)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        if (s == "stream")
+            workload = SessionConfiguration::STREAM;
+        else if (s == "ping")
+            workload = SessionConfiguration::PING;
+        else if (s == "pong")
+            workload = SessionConfiguration::PONG;
+        else if (s == "churn")
+            workload = SessionConfiguration::CHURN;
+        else
+            throw std::runtime_error("Unexpected workload");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Workload & workload)
+{
+    std::ostream::sentry sentry(out);
+
+    if (! sentry)
+        return out;
+
+    switch (workload)
+    {
+    default:
+    case SessionConfiguration::STREAM:
+        return out << "stream";
+    case SessionConfiguration::PING:
+        return out << "ping";
+    case SessionConfiguration::PONG:
+        return out << "pong";
+    case SessionConfiguration::CHURN:
+        return out << "churn";
+    }
+}
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Pacing & pacing)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        if (s == "timer")
+            pacing = SessionConfiguration::TIMER;
+        else if (s == "kernel")
+            pacing = SessionConfiguration::KERNEL;
+        else
+            throw std::runtime_error("Unexpected pacing");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Pacing & pacing)
+{
+    std::ostream::sentry sentry(out);
+
+    if (! sentry)
+        return out;
+
+    switch (pacing)
+    {
+    default:
+    case SessionConfiguration::TIMER:
+        return out << "timer";
+    case SessionConfiguration::KERNEL:
+        return out << "kernel";
+    }
+}
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Arrival & arrival)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        if (s == "uniform")
+            arrival = SessionConfiguration::UNIFORM;
+        else if (s == "on-off")
+            arrival = SessionConfiguration::ON_OFF;
+        else if (s == "poisson")
+            arrival = SessionConfiguration::POISSON;
+        else if (s == "microburst")
+            arrival = SessionConfiguration::MICROBURST;
+        else
+            throw std::runtime_error("Unexpected arrival");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Arrival & arrival)
+{
+    std::ostream::sentry sentry(out);
+
+    if (! sentry)
+        return out;
+
+    switch (arrival)
+    {
+    default:
+    case SessionConfiguration::UNIFORM:
+        return out << "uniform";
+    case SessionConfiguration::ON_OFF:
+        return out << "on-off";
+    case SessionConfiguration::POISSON:
+        return out << "poisson";
+    case SessionConfiguration::MICROBURST:
+        return out << "microburst";
+    }
+}
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Timestamping & timestamping)
+{
+    std::istream::sentry sentry(in);
+
+    if (sentry)
+    {
+        std::string s;
+        in >> s;
+
+        if (s == "none")
+            timestamping = SessionConfiguration::NO_TIMESTAMPING;
+        else if (s == "software")
+            timestamping = SessionConfiguration::SOFTWARE_TIMESTAMPING;
+        else if (s == "hardware")
+            timestamping = SessionConfiguration::HARDWARE_TIMESTAMPING;
+        else
+            throw std::runtime_error("Unexpected timestamping");
+    }
+
+    return in;
+}
+
+std::ostream &
+operator<<(std::ostream & out,
+           const SessionConfiguration::Timestamping & timestamping)
+{
+    std::ostream::sentry sentry(out);
+
+    if (! sentry)
+        return out;
+
+    switch (timestamping)
+    {
+    default:
+    case SessionConfiguration::NO_TIMESTAMPING:
+        return out << "none";
+    case SessionConfiguration::SOFTWARE_TIMESTAMPING:
+        return out << "software";
+    case SessionConfiguration::HARDWARE_TIMESTAMPING:
+        return out << "hardware";
+    }
+}
+
 } // namespace net_tester
 } // namespace enyx
 
@@ -32,6 +32,7 @@
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "Size.hpp"
+#include "BandwidthSchedule.hpp"
 #include "Range.hpp"
 
 namespace enyx {
@@ -44,20 +45,51 @@ struct SessionConfiguration
     enum Direction { RX, TX, BOTH };
     enum ShutdownPolicy { WAIT_FOR_PEER, SEND_COMPLETE, RECEIVE_COMPLETE };
     enum Protocol { UDP, TCP };
+    enum Engine { ASIO, IO_URING };
+    enum Offload { NO_OFFLOAD, GSO, GRO, GSO_GRO };
+    enum Workload { STREAM, PING, PONG, CHURN };
+    enum Pacing { TIMER, KERNEL };
+    enum Arrival { UNIFORM, ON_OFF, POISSON, MICROBURST };
+    enum Timestamping { NO_TIMESTAMPING, SOFTWARE_TIMESTAMPING,
+                        HARDWARE_TIMESTAMPING };
 
     Mode mode;
     Verify verify;
     Direction direction;
     std::string endpoint;
     Size send_bandwidth;
+    std::uint64_t send_rate;
+    BandwidthSchedule send_schedule;
     Size receive_bandwidth;
     std::uint64_t bandwidth_sampling_frequency;
+    Size burst;
+    Pacing pacing;
+    Arrival arrival;
+    Size arrival_burst;
+    boost::posix_time::time_duration arrival_gap;
     Size windows;
     Size size;
     Range<Size> packet_size;
     boost::posix_time::time_duration duration_margin;
     ShutdownPolicy shutdown_policy;
     Protocol protocol;
+    Engine engine;
+    std::size_t batch_size;
+    Offload offload;
+    bool zerocopy;
+    Timestamping timestamping;
+    Workload workload;
+    Size message_size;
+    Size response_size;
+    std::size_t pipeline_depth;
+    bool sequence_header;
+    std::size_t reuse_port;
+    bool announce;
+    std::size_t connections;
+    std::uint64_t churn_rate;
+    std::size_t churn_concurrency;
+    boost::posix_time::time_duration churn_timeout;
+    bool cpu_steering;
 };
 
 std::istream &
@@ -90,6 +122,57 @@ operator>>(std::istream & in, SessionConfiguration::Protocol & protocol);
 std::ostream &
 operator<<(std::ostream & out, const SessionConfiguration::Protocol & protocol);
 
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Engine & engine);
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Engine & engine);
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Offload & offload);
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Offload & offload);
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Workload & workload);
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Workload & workload);
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Pacing & pacing);
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Pacing & pacing);
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Arrival & arrival);
+
+std::ostream &
+operator<<(std::ostream & out, const SessionConfiguration::Arrival & arrival);
+
+std::istream &
+operator>>(std::istream & in, SessionConfiguration::Timestamping & timestamping);
+
+std::ostream &
+operator<<(std::ostream & out,
+           const SessionConfiguration::Timestamping & timestamping);
+
+inline bool
+is_gso_enabled(const SessionConfiguration & configuration)
+{
+    return configuration.offload == SessionConfiguration::GSO ||
+           configuration.offload == SessionConfiguration::GSO_GRO;
+}
+
+inline bool
+is_gro_enabled(const SessionConfiguration & configuration)
+{
+    return configuration.offload == SessionConfiguration::GRO ||
+           configuration.offload == SessionConfiguration::GSO_GRO;
+}
+
 using SessionConfigurations = std::vector<SessionConfiguration>;
 
 } // namespace net_tester
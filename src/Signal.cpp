@@ -50,6 +50,11 @@ install_signal_handlers() noexcept
 {
     std::signal(SIGINT, on_signal);
     std::signal(SIGTERM, on_signal);
+#ifdef SIGPIPE
+    // Writes submitted through io_uring can't request MSG_NOSIGNAL,
+    // broken connections are reported as EPIPE instead.
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
 }
 
 void
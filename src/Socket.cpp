@@ -24,6 +24,15 @@
 
 #include "Socket.hpp"
 
+#include <cerrno>
+#include <limits>
+
+#ifdef __linux__
+#   include <sys/socket.h>
+#endif
+
+#include <boost/system/system_error.hpp>
+
 namespace enyx {
 namespace net_tester {
 
@@ -31,5 +40,54 @@ Socket::Socket(boost::asio::io_service & io_service)
     : io_service_(io_service)
 { }
 
+bool
+Socket::parse_port(const std::string & service, unsigned short & port)
+{
+    if (service.empty() || service.size() > 5)
+        return false;
+
+    unsigned long value = 0;
+    for (char c : service)
+    {
+        if (c < '0' || c > '9')
+            return false;
+        value = value * 10 + unsigned(c - '0');
+    }
+
+    if (value > 0xffff)
+        return false;
+
+    port = static_cast<unsigned short>(value);
+    return true;
+}
+
+void
+Socket::set_max_pacing_rate(int descriptor, std::uint64_t bytes_per_second)
+{
+#ifdef __linux__
+    // Kernels before 4.20 only accept a 32 bits rate.
+    int failure;
+    if (bytes_per_second <= std::numeric_limits<std::uint32_t>::max())
+    {
+        std::uint32_t rate = std::uint32_t(bytes_per_second);
+        failure = ::setsockopt(descriptor, SOL_SOCKET, SO_MAX_PACING_RATE,
+                               &rate, sizeof(rate));
+    }
+    else
+        failure = ::setsockopt(descriptor, SOL_SOCKET, SO_MAX_PACING_RATE,
+                               &bytes_per_second, sizeof(bytes_per_second));
+
+    if (failure < 0)
+        throw boost::system::system_error{
+                boost::system::error_code{errno,
+                                          boost::system::system_category()},
+                "setsockopt SO_MAX_PACING_RATE"};
+#else
+    (void)descriptor;
+    (void)bytes_per_second;
+    throw std::runtime_error{"--pacing=kernel is only supported on Linux"};
+#endif
+}
+
 } // namespace net_tester
 } // namespace enyx
@@ -24,7 +24,16 @@
 
 #pragma once
 
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/regex.hpp>
 
@@ -44,11 +53,26 @@ protected:
     std::pair<typename Protocol::endpoint, typename Protocol::endpoint>
     resolve(const std::string & endpoint);
 
+    template<typename Protocol>
+    typename Protocol::endpoint
+    resolve(const std::string & host, const std::string & service);
+
+    static bool
+    parse_port(const std::string & service, unsigned short & port);
+
     template<typename SocketType>
     static void
     setup_windows(const SessionConfiguration & configuration,
                   SocketType & socket);
 
+    template<typename SocketType>
+    static void
+    setup_pacing(const SessionConfiguration & configuration,
+                 SocketType & socket);
+
+    static void
+    set_max_pacing_rate(int descriptor, std::uint64_t bytes_per_second);
+
 protected:
     boost::asio::io_service & io_service_;
 };
@@ -59,7 +83,8 @@ Socket::resolve(const std::string & s)
 {
     boost::smatch m;
     {
-        boost::regex r("(?:(?:([^:]+):)?([^:]+):)?([^:]+):([^:]+)");
+        static const boost::regex r(
+                "(?:(?:([^:]+):)?([^:]+):)?([^:]+):([^:]+)");
         if (! boost::regex_match(s, m, r))
         {
             std::ostringstream error;
@@ -68,16 +93,47 @@ Socket::resolve(const std::string & s)
         }
     }
 
-    typename Protocol::resolver::query local{"0"};
+    std::string local_host, local_service{"0"};
     if (m[1].matched)
-        local = typename Protocol::resolver::query{m.str(1), m.str(2)};
+        local_host = m.str(1), local_service = m.str(2);
     else if (m[2].matched)
-        local = typename Protocol::resolver::query{m.str(2)};
+        local_service = m.str(2);
+
+    return std::make_pair(resolve<Protocol>(local_host, local_service),
+                          resolve<Protocol>(m.str(3), m.str(4)));
+}
+
+template<typename Protocol>
+typename Protocol::endpoint
+Socket::resolve(const std::string & host, const std::string & service)
+{
+    // Sessions generated from endpoint ranges mostly share their hosts,
+    // hence the endpoints are cached for the process lifetime.
+    static std::mutex mutex;
+    static std::map<std::pair<std::string, std::string>,
+                    typename Protocol::endpoint> endpoints;
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto const key = std::make_pair(host, service);
+    auto it = endpoints.find(key);
+    if (it != endpoints.end())
+        return it->second;
 
-    typename Protocol::resolver::query remote{m.str(3), m.str(4)};
+    // Numeric endpoints don't require the system resolver.
+    boost::system::error_code failure;
+    auto const address = boost::asio::ip::address::from_string(host, failure);
+    unsigned short port;
+    typename Protocol::endpoint endpoint;
+    if (! host.empty() && ! failure && parse_port(service, port))
+        endpoint = typename Protocol::endpoint{address, port};
+    else if (host.empty())
+        endpoint = *typename Protocol::resolver{io_service_}.resolve(
+                typename Protocol::resolver::query{service});
+    else
+        endpoint = *typename Protocol::resolver{io_service_}.resolve(
+                typename Protocol::resolver::query{host, service});
 
-    typename Protocol::resolver r{io_service_};
-    return std::make_pair(*r.resolve(local), *r.resolve(remote));
+    return endpoints.emplace(key, endpoint).first->second;
 }
 
 template<typename SocketType>
@@ -95,5 +151,16 @@ Socket::setup_windows(const SessionConfiguration & configuration,
     }
 }
 
+template<typename SocketType>
+void
+Socket::setup_pacing(const SessionConfiguration & configuration,
+                     SocketType & socket)
+{
+    if (configuration.pacing == SessionConfiguration::KERNEL &&
+            configuration.direction != SessionConfiguration::RX)
+        set_max_pacing_rate(socket.native_handle(),
+                            configuration.send_bandwidth);
+}
+
 } // namespace net_tester
 } // namespace enyx
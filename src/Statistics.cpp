@@ -24,10 +24,13 @@
 
 #include "Statistics.hpp"
 
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <iomanip>
 
+#include <boost/io/ios_state.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 namespace enyx {
@@ -46,31 +49,249 @@ compute_bandwidth(Size bytes_count,
     if (duration.is_special() || duration.total_milliseconds() == 0)
         return "undefined";
 
-    bytes_count /= duration.total_milliseconds();
+    // Scaled before the division to not truncate the achieved rate.
     bytes_count *= 1000;
+    bytes_count /= duration.total_milliseconds();
 
     out << bytes_count << "/s";
 
     return out.str();
 }
 
+std::string
+compute_rate(std::uint64_t count, const pt::time_duration & duration)
+{
+    std::ostringstream out;
+
+    if (duration.is_special() || duration.total_microseconds() == 0)
+        return "undefined";
+
+    out << count * 1000000 / std::uint64_t(duration.total_microseconds())
+        << "/s";
+
+    return out.str();
+}
+
 } // anonymous namespace
 
+void
+BatchSizes::add(std::uint64_t count)
+{
+    ++ batches_count;
+    datagrams_count += count;
+
+    std::size_t bucket = 0;
+    while (count >>= 1)
+        ++ bucket;
+
+    ++ buckets[std::min(bucket, buckets.size() - 1)];
+}
+
+void
+BatchSizes::merge(const BatchSizes & other)
+{
+    batches_count += other.batches_count;
+    datagrams_count += other.datagrams_count;
+    for (std::size_t i = 0, e = buckets.size(); i != e; ++i)
+        buckets[i] += other.buckets[i];
+}
+
+void
+accumulate(Statistics & total, const Statistics & statistics)
+{
+    if (total.start_date.is_special() ||
+            (! statistics.start_date.is_special() &&
+             statistics.start_date < total.start_date))
+        total.start_date = statistics.start_date;
+
+    total.received_bytes_count += statistics.received_bytes_count;
+    total.received_datagrams_count += statistics.received_datagrams_count;
+    total.receive_batch_sizes.merge(statistics.receive_batch_sizes);
+    total.receive_segments_counts.merge(statistics.receive_segments_counts);
+    total.received_sequences.merge(statistics.received_sequences);
+    total.round_trip_times.merge(statistics.round_trip_times);
+    total.receive_wire_to_driver_times.merge(
+            statistics.receive_wire_to_driver_times);
+    total.receive_driver_to_user_times.merge(
+            statistics.receive_driver_to_user_times);
+    total.receive_duration = std::max(total.receive_duration,
+                                      statistics.receive_duration);
+    total.sent_bytes_count += statistics.sent_bytes_count;
+    total.sent_datagrams_count += statistics.sent_datagrams_count;
+    total.send_batch_sizes.merge(statistics.send_batch_sizes);
+    total.send_segments_counts.merge(statistics.send_segments_counts);
+    total.sent_zerocopy_count += statistics.sent_zerocopy_count;
+    total.sent_copied_count += statistics.sent_copied_count;
+    total.send_duration = std::max(total.send_duration,
+                                   statistics.send_duration);
+    total.receive_target_bandwidth += statistics.receive_target_bandwidth;
+    total.send_target_bandwidth += statistics.send_target_bandwidth;
+    total.send_target_datagram_rate += statistics.send_target_datagram_rate;
+    total.receive_peak_bandwidth = std::max(total.receive_peak_bandwidth,
+                                            statistics.receive_peak_bandwidth);
+    total.send_peak_bandwidth = std::max(total.send_peak_bandwidth,
+                                         statistics.send_peak_bandwidth);
+    total.sent_datagram_gaps.merge(statistics.sent_datagram_gaps);
+    total.sent_burst_sizes.merge(statistics.sent_burst_sizes);
+    total.sent_burst_intervals.merge(statistics.sent_burst_intervals);
+    total.send_user_to_qdisc_times.merge(statistics.send_user_to_qdisc_times);
+    total.send_qdisc_to_driver_times.merge(
+            statistics.send_qdisc_to_driver_times);
+    total.send_driver_to_wire_times.merge(
+            statistics.send_driver_to_wire_times);
+    total.memory_bytes_count += statistics.memory_bytes_count;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const BatchSizes & batch_sizes)
+{
+    std::ostream::sentry sentry(out);
+
+    if (sentry)
+    {
+        {
+            boost::io::ios_all_saver s(out);
+            out << "mean " << std::fixed << std::setprecision(1)
+                << double(batch_sizes.datagrams_count) /
+                   double(batch_sizes.batches_count);
+        }
+
+        for (std::size_t i = 0, e = batch_sizes.buckets.size(); i != e; ++i)
+        {
+            if (! batch_sizes.buckets[i])
+                continue;
+
+            std::uint64_t low = 1ULL << i, high = (low << 1) - 1;
+            out << ", " << low;
+            if (high != low)
+                out << "-" << high;
+            out << ": " << batch_sizes.buckets[i];
+        }
+    }
+
+    return out;
+}
+
 std::ostream &
 operator<<(std::ostream & out, const Statistics & statistics)
 {
-    return out << "started: " << statistics.start_date << "\n"
-               << "received_bytes_count: "
-               << statistics.received_bytes_count << "\n"
-               << "receive_bandwidth: "
-               << compute_bandwidth(statistics.received_bytes_count,
-                                   statistics.receive_duration) << "\n"
-               << "sent_bytes_count: "
-               << statistics.sent_bytes_count << "\n"
-               << "send_bandwidth: "
-               << compute_bandwidth(statistics.sent_bytes_count,
-                                   statistics.send_duration)
-               << std::endl;
+    out << "started: " << statistics.start_date << "\n"
+        << "memory_bytes_count: " << statistics.memory_bytes_count << "\n"
+        << "received_bytes_count: "
+        << Size(statistics.received_bytes_count) << "\n";
+
+    if (statistics.received_datagrams_count)
+        out << "received_datagrams_count: "
+            << statistics.received_datagrams_count << "\n";
+
+    if (statistics.receive_batch_sizes.batches_count)
+        out << "receive_batch_sizes: "
+            << statistics.receive_batch_sizes << "\n";
+
+    if (statistics.receive_segments_counts.batches_count)
+        out << "receive_segments_counts: "
+            << statistics.receive_segments_counts << "\n";
+
+    if (! statistics.received_sequences.is_empty())
+        out << "received_sequences: "
+            << statistics.received_sequences << "\n";
+
+    if (statistics.round_trip_times.count())
+        out << "round_trip_times: "
+            << statistics.round_trip_times << "\n"
+            << "transaction_rate: "
+            << compute_rate(statistics.round_trip_times.count(),
+                            statistics.receive_duration) << "\n";
+
+    if (statistics.receive_wire_to_driver_times.count())
+        out << "receive_wire_to_driver_times: "
+            << statistics.receive_wire_to_driver_times << "\n";
+
+    if (statistics.receive_driver_to_user_times.count())
+        out << "receive_driver_to_user_times: "
+            << statistics.receive_driver_to_user_times << "\n";
+
+    if (statistics.receive_target_bandwidth)
+        out << "receive_target_bandwidth: "
+            << Size(statistics.receive_target_bandwidth) << "/s\n";
+
+    out << "receive_bandwidth: "
+        << compute_bandwidth(Size(statistics.received_bytes_count),
+                            statistics.receive_duration) << "\n";
+
+    if (statistics.receive_peak_bandwidth)
+        out << "receive_peak_bandwidth: "
+            << Size(statistics.receive_peak_bandwidth) << "/s\n";
+
+    out << "sent_bytes_count: "
+        << Size(statistics.sent_bytes_count) << "\n";
+
+    if (statistics.sent_datagrams_count)
+        out << "sent_datagrams_count: "
+            << statistics.sent_datagrams_count << "\n";
+
+    if (statistics.send_batch_sizes.batches_count)
+        out << "send_batch_sizes: "
+            << statistics.send_batch_sizes << "\n";
+
+    if (statistics.send_segments_counts.batches_count)
+        out << "send_segments_counts: "
+            << statistics.send_segments_counts << "\n";
+
+    if (statistics.sent_zerocopy_count || statistics.sent_copied_count)
+        out << "sent_zerocopy_count: "
+            << statistics.sent_zerocopy_count << "\n"
+            << "sent_copied_count: "
+            << statistics.sent_copied_count << "\n";
+
+    if (statistics.send_target_datagram_rate)
+        out << "send_target_datagram_rate: "
+            << statistics.send_target_datagram_rate << "/s\n";
+
+    if (statistics.sent_datagrams_count)
+        out << "send_datagram_rate: "
+            << compute_rate(statistics.sent_datagrams_count,
+                            statistics.send_duration) << "\n";
+
+    if (statistics.sent_datagram_gaps.count())
+        out << "sent_datagram_gaps: "
+            << statistics.sent_datagram_gaps << "\n";
+
+    if (statistics.sent_burst_sizes.count())
+    {
+        out << "sent_burst_sizes: ";
+        write(out, statistics.sent_burst_sizes, "B") << "\n";
+    }
+
+    if (statistics.sent_burst_intervals.count())
+        out << "sent_burst_intervals: "
+            << statistics.sent_burst_intervals << "\n";
+
+    if (statistics.send_user_to_qdisc_times.count())
+        out << "send_user_to_qdisc_times: "
+            << statistics.send_user_to_qdisc_times << "\n";
+
+    if (statistics.send_qdisc_to_driver_times.count())
+        out << "send_qdisc_to_driver_times: "
+            << statistics.send_qdisc_to_driver_times << "\n";
+
+    if (statistics.send_driver_to_wire_times.count())
+        out << "send_driver_to_wire_times: "
+            << statistics.send_driver_to_wire_times << "\n";
+
+    if (statistics.send_target_bandwidth)
+        out << "send_target_bandwidth: "
+            << Size(statistics.send_target_bandwidth) << "/s\n";
+
+    out << "send_bandwidth: "
+        << compute_bandwidth(Size(statistics.sent_bytes_count),
+                            statistics.send_duration) << "\n";
+
+    if (statistics.send_peak_bandwidth)
+        out << "send_peak_bandwidth: "
+            << Size(statistics.send_peak_bandwidth) << "/s\n";
+
+    return out << std::flush;
 }
 
 } // namespace net_tester
@@ -25,28 +25,83 @@
 #pragma once
 
 #include <stdint.h>
+#include <array>
 #include <iosfwd>
 
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "Size.hpp"
 #include "CacheLine.hpp"
+#include "Counter.hpp"
+#include "Histogram.hpp"
+#include "Sequence.hpp"
 
 namespace enyx {
 namespace net_tester {
 
+// Distribution of the datagrams count per sendmmsg()/recvmmsg() call,
+// or per segmentation offloaded send/receive.
+// Bucket i counts the batches of [2^i, 2^(i + 1)) datagrams.
+struct BatchSizes
+{
+    void
+    add(std::uint64_t datagrams_count);
+
+    void
+    merge(const BatchSizes & other);
+
+    std::uint64_t batches_count;
+    std::uint64_t datagrams_count;
+    std::array<std::uint64_t, 11> buckets;
+};
+
 struct Statistics
 {
     boost::posix_time::ptime start_date;
-    Size received_bytes_count;
+    Counter received_bytes_count;
+    Counter received_datagrams_count;
+    BatchSizes receive_batch_sizes;
+    BatchSizes receive_segments_counts;
+    Histogram round_trip_times;
+    // From --timestamping.
+    Histogram receive_wire_to_driver_times;
+    Histogram receive_driver_to_user_times;
+    SequenceTracker received_sequences;
     boost::posix_time::time_duration receive_duration;
+    std::uint64_t receive_target_bandwidth;
+    std::uint64_t receive_peak_bandwidth;
     // As receive and send can be performed by two different threads
     // ensure no false sharing occurs.
     CacheLine padding;
-    Size sent_bytes_count;
+    Counter sent_bytes_count;
+    Counter sent_datagrams_count;
+    BatchSizes send_batch_sizes;
+    BatchSizes send_segments_counts;
+    std::uint64_t sent_zerocopy_count;
+    std::uint64_t sent_copied_count;
     boost::posix_time::time_duration send_duration;
+    // Follows --tx-schedule during the transfer.
+    Counter send_target_bandwidth;
+    std::uint64_t send_target_datagram_rate;
+    Histogram sent_datagram_gaps;
+    Histogram sent_burst_sizes;
+    Histogram sent_burst_intervals;
+    Histogram send_user_to_qdisc_times;
+    Histogram send_qdisc_to_driver_times;
+    Histogram send_driver_to_wire_times;
+    std::uint64_t send_peak_bandwidth;
+    std::uint64_t memory_bytes_count;
 };
 
+// Add the transfer counters and merge the histograms of statistics
+// into total, the durations being the longest ones as the sessions run
+// concurrently.
+void
+accumulate(Statistics & total, const Statistics & statistics);
+
+std::ostream &
+operator<<(std::ostream & out, const BatchSizes & batch_sizes);
+
 std::ostream &
 operator<<(std::ostream & out, const Statistics & statistics);
 
@@ -0,0 +1,281 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Summary.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/io/ios_state.hpp>
+
+#include "Size.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+namespace pt = boost::posix_time;
+
+namespace {
+
+double
+compute_bandwidth(std::uint64_t bytes_count, const pt::time_duration & duration)
+{
+    if (duration.is_special() || duration.total_microseconds() <= 0)
+        return 0.;
+
+    return double(bytes_count) * 1e6 / double(duration.total_microseconds());
+}
+
+Size
+to_size(double bandwidth)
+{
+    return Size(std::uint64_t(std::llround(bandwidth)));
+}
+
+} // anonymous namespace
+
+Summary::Summary(std::size_t threads_count,
+                 std::size_t slowest_sessions_count)
+    : slowest_sessions_count_(slowest_sessions_count),
+      sessions_(),
+      threads_(threads_count),
+      total_()
+{
+}
+
+void
+Summary::add(const SessionConfiguration & configuration,
+             std::size_t thread_index,
+             const Statistics & statistics)
+{
+    sessions_.push_back(SessionBandwidths{
+            configuration.endpoint,
+            configuration.direction != SessionConfiguration::TX,
+            configuration.direction != SessionConfiguration::RX,
+            compute_bandwidth(statistics.received_bytes_count,
+                              statistics.receive_duration),
+            compute_bandwidth(statistics.sent_bytes_count,
+                              statistics.send_duration)});
+
+    ThreadTotal & thread = threads_[thread_index];
+    ++ thread.sessions_count;
+    accumulate(thread.statistics, statistics);
+    accumulate(total_, statistics);
+}
+
+void
+Summary::add_results(Results & results) const
+{
+    auto & record = results.add("summary", "", {});
+    record.add("sessions_count", std::uint64_t(sessions_.size()));
+    record.add("receive_bandwidth", std::uint64_t(std::llround(
+            compute_bandwidth(total_.received_bytes_count,
+                              total_.receive_duration))));
+    record.add("send_bandwidth", std::uint64_t(std::llround(
+            compute_bandwidth(total_.sent_bytes_count,
+                              total_.send_duration))));
+    add_distribution(record, "receive", get_distribution(true));
+    add_distribution(record, "send", get_distribution(false));
+
+    auto const slowest = get_slowest_sessions();
+    for (std::size_t i = 0, e = slowest.size(); i != e; ++i)
+    {
+        auto & session = results.add("slowest_session",
+                                     slowest[i].endpoint, {});
+        session.add("rank", std::uint64_t(i));
+        session.add("receive_bandwidth",
+                    std::uint64_t(std::llround(slowest[i].receive)));
+        session.add("send_bandwidth",
+                    std::uint64_t(std::llround(slowest[i].send)));
+    }
+}
+
+Summary::Distribution
+Summary::get_distribution(bool is_receive) const
+{
+    std::vector<double> bandwidths;
+    for (auto const& session : sessions_)
+        if (is_receive ? session.is_receiving : session.is_sending)
+            bandwidths.push_back(is_receive ? session.receive : session.send);
+
+    Distribution distribution{};
+    if (bandwidths.empty())
+        return distribution;
+
+    std::sort(bandwidths.begin(), bandwidths.end());
+
+    double sum = 0., squares_sum = 0.;
+    for (double b : bandwidths)
+    {
+        sum += b;
+        squares_sum += b * b;
+    }
+
+    std::size_t const size = bandwidths.size();
+    double const count = double(size),
+                 mean = sum / count,
+                 variance = std::max(squares_sum / count - mean * mean, 0.);
+
+    // Nearest rank, the median being the mean of the two middle
+    // bandwidths when their count is even.
+    auto const percentile = [&](double percentage) {
+        auto rank = std::size_t(std::ceil(percentage / 100. * count));
+        return bandwidths[std::max(rank, std::size_t(1)) - 1];
+    };
+
+    distribution.count = size;
+    distribution.min = bandwidths.front();
+    distribution.p10 = percentile(10.);
+    distribution.median = size % 2 ?
+            bandwidths[size / 2] :
+            (bandwidths[size / 2 - 1] + bandwidths[size / 2]) / 2.;
+    distribution.p90 = percentile(90.);
+    distribution.max = bandwidths.back();
+    distribution.stddev = std::sqrt(variance);
+    // Jain index: 1 when all the sessions get the same bandwidth,
+    // 1 / n when a single one gets it all.
+    distribution.fairness_index = squares_sum ?
+            sum * sum / (count * squares_sum) : 1.;
+
+    return distribution;
+}
+
+void
+Summary::write_distribution(std::ostream & out,
+                            const char * name,
+                            const Distribution & distribution)
+{
+    if (! distribution.count)
+        return;
+
+    out << "session_" << name << "_bandwidths: "
+        << "min " << to_size(distribution.min) << "/s, "
+        << "p10 " << to_size(distribution.p10) << "/s, "
+        << "median " << to_size(distribution.median) << "/s, "
+        << "p90 " << to_size(distribution.p90) << "/s, "
+        << "max " << to_size(distribution.max) << "/s, "
+        << "stddev " << to_size(distribution.stddev) << "/s\n";
+
+    boost::io::ios_flags_saver s(out);
+    out << name << "_fairness_index: " << std::fixed << std::setprecision(3)
+        << distribution.fairness_index << "\n";
+}
+
+void
+Summary::add_distribution(Results::Record & record,
+                          const std::string & name,
+                          const Distribution & distribution)
+{
+    if (! distribution.count)
+        return;
+
+    auto const add = [&](const char * suffix, double bandwidth) {
+        record.add("session_" + name + "_bandwidths_" + suffix,
+                   std::uint64_t(std::llround(bandwidth)));
+    };
+    add("min", distribution.min);
+    add("p10", distribution.p10);
+    add("p50", distribution.median);
+    add("p90", distribution.p90);
+    add("max", distribution.max);
+    add("stddev", distribution.stddev);
+    record.add(name + "_fairness_index", distribution.fairness_index);
+}
+
+std::vector<Summary::SessionBandwidths>
+Summary::get_slowest_sessions() const
+{
+    // A session is as slow as its slowest configured direction.
+    auto const bandwidth = [](const SessionBandwidths & s) {
+        if (! s.is_receiving)
+            return s.send;
+        if (! s.is_sending)
+            return s.receive;
+        return std::min(s.receive, s.send);
+    };
+
+    auto slowest = sessions_;
+    std::size_t const count = std::min(slowest_sessions_count_,
+                                       slowest.size());
+    std::partial_sort(slowest.begin(), slowest.begin() + count, slowest.end(),
+            [&](const SessionBandwidths & a, const SessionBandwidths & b) {
+        return bandwidth(a) < bandwidth(b);
+    });
+    slowest.resize(count);
+
+    return slowest;
+}
+
+std::ostream &
+operator<<(std::ostream & out, const Summary & summary)
+{
+    std::ostream::sentry sentry(out);
+    if (! sentry)
+        return out;
+
+    out << "summary:\n"
+        << "sessions_count: " << summary.sessions_.size() << "\n"
+        << "receive_bandwidth: "
+        << to_size(compute_bandwidth(summary.total_.received_bytes_count,
+                                     summary.total_.receive_duration))
+        << "/s\n"
+        << "send_bandwidth: "
+        << to_size(compute_bandwidth(summary.total_.sent_bytes_count,
+                                     summary.total_.send_duration))
+        << "/s\n";
+
+    // A single thread runs all the sessions.
+    for (std::size_t i = 0, e = summary.threads_.size(); e > 1 && i != e; ++i)
+    {
+        auto const& thread = summary.threads_[i];
+        out << "thread " << i
+            << " sessions_count: " << thread.sessions_count
+            << ", receive_bandwidth: "
+            << to_size(compute_bandwidth(thread.statistics.received_bytes_count,
+                                         thread.statistics.receive_duration))
+            << "/s, send_bandwidth: "
+            << to_size(compute_bandwidth(thread.statistics.sent_bytes_count,
+                                         thread.statistics.send_duration))
+            << "/s\n";
+    }
+
+    Summary::write_distribution(out, "receive",
+                                summary.get_distribution(true));
+    Summary::write_distribution(out, "send",
+                                summary.get_distribution(false));
+
+    auto const slowest = summary.get_slowest_sessions();
+    for (std::size_t i = 0, e = slowest.size(); i != e; ++i)
+        out << "slowest_session " << i << ": " << slowest[i].endpoint
+            << ", receive_bandwidth: " << to_size(slowest[i].receive)
+            << "/s, send_bandwidth: " << to_size(slowest[i].send) << "/s\n";
+
+    return out << std::flush;
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,121 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "Results.hpp"
+#include "SessionConfiguration.hpp"
+#include "Statistics.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+// Aggregate of the sessions statistics printed at the end of the run:
+// the total and per thread bandwidths, the distribution of the sessions
+// bandwidths with their Jain fairness index, and the slowest sessions.
+// Only the directions a session is configured to transfer are accounted,
+// hence a stalled session counts as a zero bandwidth.
+class Summary
+{
+public:
+    Summary(std::size_t threads_count, std::size_t slowest_sessions_count);
+
+    void
+    add(const SessionConfiguration & configuration,
+        std::size_t thread_index,
+        const Statistics & statistics);
+
+    // Add the summary record and a record per slowest session.
+    void
+    add_results(Results & results) const;
+
+    std::size_t
+    size() const
+    { return sessions_.size(); }
+
+    friend std::ostream &
+    operator<<(std::ostream & out, const Summary & summary);
+
+private:
+    // Bandwidths are in bytes per second.
+    struct SessionBandwidths
+    {
+        std::string endpoint;
+        bool is_receiving;
+        bool is_sending;
+        double receive;
+        double send;
+    };
+
+    struct Distribution
+    {
+        std::size_t count;
+        double min;
+        double p10;
+        double median;
+        double p90;
+        double max;
+        double stddev;
+        double fairness_index;
+    };
+
+    struct ThreadTotal
+    {
+        std::size_t sessions_count;
+        Statistics statistics;
+    };
+
+private:
+    // Sessions count is 0 when none transfers in that direction.
+    Distribution
+    get_distribution(bool is_receive) const;
+
+    static void
+    write_distribution(std::ostream & out,
+                       const char * name,
+                       const Distribution & distribution);
+
+    static void
+    add_distribution(Results::Record & record,
+                     const std::string & name,
+                     const Distribution & distribution);
+
+    std::vector<SessionBandwidths>
+    get_slowest_sessions() const;
+
+private:
+    std::size_t slowest_sessions_count_;
+    std::vector<SessionBandwidths> sessions_;
+    std::vector<ThreadTotal> threads_;
+    Statistics total_;
+};
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,376 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TcpChurn.hpp"
+
+#include <iostream>
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "Error.hpp"
+#include "PatternBuffer.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+namespace ao = boost::asio;
+namespace pt = boost::posix_time;
+
+TcpChurn::TcpChurn(boost::asio::io_service & io_service,
+                   const SessionConfiguration & configuration)
+    : Socket(io_service),
+      configuration_(configuration),
+      local_endpoint_(),
+      remote_endpoint_(),
+      timer_(io_service),
+      start_interval_(),
+      start_(),
+      end_(),
+      started_count_(),
+      due_count_(),
+      active_count_(),
+      completed_count_(),
+      connect_failures_count_(),
+      transaction_failures_count_(),
+      timeouts_count_(),
+      connect_times_(),
+      statistics_(),
+      failure_()
+{
+    const auto e = resolve<TcpSocket::protocol_type>(configuration_.endpoint);
+    local_endpoint_ = e.first;
+    remote_endpoint_ = e.second;
+
+    if (configuration_.churn_rate)
+        start_interval_ = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::seconds{1}) / configuration_.churn_rate;
+
+    connect_times_.initialize();
+    statistics_.round_trip_times.initialize();
+}
+
+void
+TcpChurn::start()
+{
+    start_ = Clock::now();
+    statistics_.start_date = pt::microsec_clock::universal_time();
+
+    if (configuration_.churn_rate)
+    {
+        timer_.expires_at(start_);
+        async_wait_next_start();
+    }
+    else
+        while (started_count_ != configuration_.connections &&
+                active_count_ != configuration_.churn_concurrency)
+            start_connection();
+}
+
+boost::system::error_code
+TcpChurn::finalize()
+{
+    // The connections are all sending and receiving from start to end.
+    auto const duration = get_duration();
+    statistics_.receive_duration = statistics_.send_duration =
+            pt::microseconds(duration / 1000);
+    statistics_.memory_bytes_count = sizeof(TcpChurn);
+
+    std::cout << "churn: " << configuration_.endpoint << "\n"
+              << "connections: " << completed_count_ << "\n";
+    if (duration)
+        std::cout << "connection_rate: "
+                  << std::uint64_t(double(completed_count_) * 1e9 /
+                                   double(duration))
+                  << "/s\n";
+    std::cout << "connect_failures_count: " << connect_failures_count_ << "\n"
+              << "transaction_failures_count: "
+              << transaction_failures_count_ << "\n"
+              << "timeouts_count: " << timeouts_count_ << "\n"
+              << "connect_times: " << connect_times_ << "\n"
+              << statistics_ << std::endl;
+    std::cout << "status: " << failure_ << std::endl;
+
+    return failure_;
+}
+
+void
+TcpChurn::add_results(Results & results, Statistics & total) const
+{
+    auto const duration = get_duration();
+
+    auto & record = results.add("churn", configuration_.endpoint, failure_);
+    record.add("connections", std::uint64_t(completed_count_));
+    record.add("duration", duration);
+    record.add("connection_rate", duration ?
+            std::uint64_t(double(completed_count_) * 1e9 / double(duration)) :
+            0);
+    record.add("connect_failures_count", connect_failures_count_);
+    record.add("transaction_failures_count", transaction_failures_count_);
+    record.add("timeouts_count", timeouts_count_);
+    record.add("connect_times", connect_times_);
+    record.add(statistics_);
+
+    accumulate(total, statistics_);
+}
+
+std::uint64_t
+TcpChurn::get_duration() const
+{
+    auto const end = completed_count_ == configuration_.connections ?
+                     end_ : Clock::now();
+    return std::uint64_t(std::chrono::duration_cast<
+            std::chrono::nanoseconds>(end - start_).count());
+}
+
+void
+TcpChurn::async_wait_next_start()
+{
+    auto self(shared_from_this());
+    timer_.async_wait([this, self](const boost::system::error_code & failure) {
+        if (failure)
+            return;
+
+        // A start due while the concurrency limit is reached is
+        // deferred until a connection completes.
+        if (active_count_ != configuration_.churn_concurrency)
+            start_connection();
+        else
+            ++ due_count_;
+
+        if (started_count_ + due_count_ != configuration_.connections)
+        {
+            timer_.expires_at(timer_.expires_at() + start_interval_);
+            async_wait_next_start();
+        }
+    });
+}
+
+void
+TcpChurn::start_connection()
+{
+    ++ started_count_;
+    ++ active_count_;
+
+    auto connection = std::make_shared<Connection>(io_service_);
+    connection->response.resize(configuration_.response_size ?
+                                std::size_t(configuration_.response_size) :
+                                std::size_t(configuration_.message_size));
+
+    auto & socket = connection->socket;
+    boost::system::error_code failure;
+    socket.open(remote_endpoint_.protocol(), failure);
+    if (! failure)
+        socket.set_option(TcpSocket::socket_type::reuse_address{true},
+                          failure);
+    if (! failure)
+        socket.bind(local_endpoint_, failure);
+    if (! failure)
+        socket.set_option(ao::ip::tcp::no_delay{true}, failure);
+
+    auto self(shared_from_this());
+    if (failure)
+    {
+        // Closed from the io_service as close() may start
+        // another connection.
+        ++ connect_failures_count_;
+        io_service_.post([this, self, connection, failure] {
+            close(connection, failure);
+        });
+        return;
+    }
+
+    setup_windows(configuration_, socket);
+
+    async_wait_deadline(connection);
+
+    connection->start = Clock::now();
+    socket.async_connect(remote_endpoint_, [this, self, connection]
+            (const boost::system::error_code & failure) {
+        on_connect(connection, failure);
+    });
+}
+
+void
+TcpChurn::async_wait_deadline(const ConnectionPtr & connection)
+{
+    connection->deadline.expires_from_now(std::chrono::microseconds{
+            configuration_.churn_timeout.total_microseconds()});
+
+    // Closing the socket aborts the pending operation, whose handler
+    // then reports the timeout.
+    connection->deadline.async_wait([connection]
+            (const boost::system::error_code & failure) {
+        if (failure)
+            return;
+
+        connection->is_timed_out = true;
+        boost::system::error_code ignored;
+        connection->socket.close(ignored);
+    });
+}
+
+void
+TcpChurn::time_out(const ConnectionPtr & connection)
+{
+    ++ timeouts_count_;
+    close(connection, ao::error::timed_out);
+}
+
+void
+TcpChurn::on_connect(const ConnectionPtr & connection,
+                     const boost::system::error_code & failure)
+{
+    if (connection->is_timed_out)
+        return time_out(connection);
+
+    if (failure)
+    {
+        ++ connect_failures_count_;
+        close(connection, failure);
+        return;
+    }
+
+    record(connect_times_, connection->start);
+
+    connection->start = Clock::now();
+    auto self(shared_from_this());
+    ao::async_write(connection->socket,
+            ao::buffer(get_pattern_buffer(), configuration_.message_size),
+            [this, self, connection]
+            (const boost::system::error_code & failure, std::size_t size) {
+        statistics_.sent_bytes_count += size;
+        on_request_sent(connection, failure);
+    });
+}
+
+void
+TcpChurn::on_request_sent(const ConnectionPtr & connection,
+                          const boost::system::error_code & failure)
+{
+    if (connection->is_timed_out)
+        return time_out(connection);
+
+    if (failure)
+    {
+        ++ transaction_failures_count_;
+        close(connection, failure);
+        return;
+    }
+
+    auto self(shared_from_this());
+    ao::async_read(connection->socket, ao::buffer(connection->response),
+            [this, self, connection]
+            (const boost::system::error_code & failure, std::size_t size) {
+        statistics_.received_bytes_count += size;
+        on_response_received(connection, failure);
+    });
+}
+
+void
+TcpChurn::on_response_received(const ConnectionPtr & connection,
+                               const boost::system::error_code & failure)
+{
+    if (connection->is_timed_out)
+        return time_out(connection);
+
+    if (failure)
+    {
+        ++ transaction_failures_count_;
+        close(connection, failure == ao::error::eof ? error::unexpected_eof
+                                                    : failure);
+        return;
+    }
+
+    record(statistics_.round_trip_times, connection->start);
+
+    // Wait for the peer to close its side once it got ours.
+    boost::system::error_code ignored;
+    connection->socket.shutdown(TcpSocket::socket_type::shutdown_send,
+                                ignored);
+
+    auto self(shared_from_this());
+    connection->socket.async_receive(ao::buffer(&connection->eof_byte, 1),
+            [this, self, connection]
+            (const boost::system::error_code & failure, std::size_t) {
+        on_eof(connection, failure);
+    });
+}
+
+void
+TcpChurn::on_eof(const ConnectionPtr & connection,
+                 const boost::system::error_code & failure)
+{
+    if (connection->is_timed_out)
+        return time_out(connection);
+
+    if (failure == ao::error::eof)
+        close(connection, boost::system::error_code{});
+    else
+    {
+        ++ transaction_failures_count_;
+        close(connection, failure ? failure : error::unexpected_data);
+    }
+}
+
+void
+TcpChurn::close(const ConnectionPtr & connection,
+                const boost::system::error_code & failure)
+{
+    boost::system::error_code ignored;
+    connection->deadline.cancel(ignored);
+    connection->socket.close(ignored);
+
+    if (failure && ! failure_)
+        failure_ = failure;
+
+    -- active_count_;
+    if (++ completed_count_ == configuration_.connections)
+    {
+        end_ = Clock::now();
+        return;
+    }
+
+    if (due_count_)
+    {
+        -- due_count_;
+        start_connection();
+    }
+    else if (! configuration_.churn_rate &&
+             started_count_ != configuration_.connections)
+        start_connection();
+}
+
+void
+TcpChurn::record(Histogram & histogram, Clock::time_point start)
+{
+    histogram.record(std::uint64_t(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    Clock::now() - start).count()));
+}
+
+} // namespace net_tester
+} // namespace enyx
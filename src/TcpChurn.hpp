@@ -0,0 +1,171 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "Histogram.hpp"
+#include "Results.hpp"
+#include "SessionConfiguration.hpp"
+#include "Socket.hpp"
+#include "Statistics.hpp"
+#include "TcpSocket.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+// Open the configured count of connections to a single endpoint, each
+// connection sending a request, receiving its echo and being closed,
+// i.e. a TCP_CRR workload.
+//
+// Connections are started at --churn-rate per second, or as soon as one
+// completes when unlimited, with at most --churn-concurrency of them in
+// flight. A failed connection, or one exceeding --churn-timeout, is
+// counted and doesn't stop the others.
+class TcpChurn : public Socket,
+                 public std::enable_shared_from_this<TcpChurn>
+{
+public:
+    TcpChurn(boost::asio::io_service & io_service,
+             const SessionConfiguration & configuration);
+
+    TcpChurn(const TcpChurn &) = delete;
+
+    // Must be called before the threads are started.
+    void
+    start();
+
+    // Print the statistics and return the first failure.
+    boost::system::error_code
+    finalize();
+
+    // Add the churn record, and its statistics to total.
+    void
+    add_results(Results & results, Statistics & total) const;
+
+    boost::asio::io_service &
+    get_io_service() const
+    { return io_service_; }
+
+    // The request/response round trips are the transactions.
+    const Statistics &
+    get_statistics() const
+    { return statistics_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Connection
+    {
+        explicit
+        Connection(boost::asio::io_service & io_service)
+            : socket(io_service),
+              deadline(io_service),
+              is_timed_out(),
+              start(),
+              response(),
+              eof_byte()
+        { }
+
+        TcpSocket::socket_type socket;
+        boost::asio::steady_timer deadline;
+        // The socket has been closed by the deadline.
+        bool is_timed_out;
+        Clock::time_point start;
+        std::vector<std::uint8_t> response;
+        std::uint8_t eof_byte;
+    };
+
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
+private:
+    void
+    async_wait_next_start();
+
+    void
+    start_connection();
+
+    void
+    async_wait_deadline(const ConnectionPtr & connection);
+
+    void
+    time_out(const ConnectionPtr & connection);
+
+    void
+    on_connect(const ConnectionPtr & connection,
+               const boost::system::error_code & failure);
+
+    void
+    on_request_sent(const ConnectionPtr & connection,
+                    const boost::system::error_code & failure);
+
+    void
+    on_response_received(const ConnectionPtr & connection,
+                         const boost::system::error_code & failure);
+
+    void
+    on_eof(const ConnectionPtr & connection,
+           const boost::system::error_code & failure);
+
+    void
+    close(const ConnectionPtr & connection,
+          const boost::system::error_code & failure);
+
+    void
+    record(Histogram & histogram, Clock::time_point start);
+
+    std::uint64_t
+    get_duration() const;
+
+private:
+    SessionConfiguration configuration_;
+    TcpSocket::protocol_type::endpoint local_endpoint_;
+    TcpSocket::protocol_type::endpoint remote_endpoint_;
+    boost::asio::steady_timer timer_;
+    Clock::duration start_interval_;
+    Clock::time_point start_;
+    Clock::time_point end_;
+    std::size_t started_count_;
+    std::size_t due_count_;
+    std::size_t active_count_;
+    std::size_t completed_count_;
+    std::uint64_t connect_failures_count_;
+    std::uint64_t transaction_failures_count_;
+    std::uint64_t timeouts_count_;
+    Histogram connect_times_;
+    Statistics statistics_;
+    boost::system::error_code failure_;
+};
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,268 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TcpListener.hpp"
+
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#   include <linux/filter.h>
+#   include <sys/socket.h>
+#endif
+
+#include <boost/system/system_error.hpp>
+
+#if defined(__linux__) && ! defined(SO_ATTACH_REUSEPORT_CBPF)
+#   define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+namespace enyx {
+namespace net_tester {
+
+namespace ao = boost::asio;
+
+TcpListener::TcpListener(const IoServices & io_services,
+                         const SessionConfiguration & configuration)
+    : Socket(*io_services.front()),
+      io_services_(io_services),
+      configuration_(configuration),
+      acceptors_(),
+      accept_timer_(*io_services.front()),
+      accepted_count_(),
+      mutex_(),
+      sessions_(),
+      failure_()
+{
+    const auto e = resolve<TcpSocket::protocol_type>(configuration_.endpoint);
+
+#ifndef SO_REUSEPORT
+    if (io_services_.size() > 1)
+        throw std::runtime_error{"--connections with several threads "
+                                 "requires SO_REUSEPORT"};
+#endif
+
+    for (auto & io_service : io_services_)
+    {
+        AcceptorPtr a{new TcpSocket::acceptor_type{*io_service,
+                                                   e.second.protocol()}};
+        a->set_option(ao::socket_base::reuse_address{true});
+#ifdef SO_REUSEPORT
+        using reuse_port = ao::detail::socket_option::boolean<SOL_SOCKET,
+                                                              SO_REUSEPORT>;
+        a->set_option(reuse_port{true});
+#endif
+        setup_windows(configuration_, *a);
+        // Accepted sockets inherit SO_ZEROCOPY.
+        if (configuration_.zerocopy)
+            TcpSocket::enable_zerocopy(a->native_handle());
+        a->bind(e.second);
+        a->listen();
+        acceptors_.push_back(std::move(a));
+    }
+
+    if (configuration_.cpu_steering)
+        steer_to_cpu();
+}
+
+void
+TcpListener::start()
+{
+    // As a listening session, fail when the peers don't all connect
+    // within the time allowed to the transfer.
+    accept_timer_.expires_from_now(
+            Session::estimate_test_duration(configuration_));
+    auto self(shared_from_this());
+    accept_timer_.async_wait([this, self]
+                             (const boost::system::error_code & failure) {
+        on_accept_timeout(failure);
+    });
+
+    for (std::size_t i = 0, e = acceptors_.size(); i != e; ++i)
+        async_accept(i);
+}
+
+boost::system::error_code
+TcpListener::finalize()
+{
+    Statistics total{};
+    boost::system::error_code first_failure = failure_;
+    for (auto & session : sessions_)
+    {
+        boost::system::error_code failure = session->finalize();
+        accumulate(total, session->get_statistics());
+        if (failure && ! first_failure)
+            first_failure = failure;
+    }
+
+    std::cout << "listener: " << configuration_.endpoint << "\n"
+              << "connections: " << sessions_.size() << "\n"
+              << total << std::endl;
+    std::cout << "status: " << first_failure << std::endl;
+
+    return first_failure;
+}
+
+void
+TcpListener::add_results(Results & results, Statistics & total) const
+{
+    Statistics listener_total{};
+    boost::system::error_code first_failure = failure_;
+    for (auto & session : sessions_)
+    {
+        auto const& failure = session->get_failure();
+        results.add("connection", configuration_.endpoint, failure)
+               .add(session->get_statistics());
+        accumulate(listener_total, session->get_statistics());
+        if (failure && ! first_failure)
+            first_failure = failure;
+    }
+
+    auto & record = results.add("listener", configuration_.endpoint,
+                                first_failure);
+    record.add("connections", std::uint64_t(sessions_.size()));
+    record.add(listener_total);
+    accumulate(total, listener_total);
+}
+
+std::vector<TcpListener::SessionPtr>
+TcpListener::copy_sessions() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return sessions_;
+}
+
+void
+TcpListener::async_accept(std::size_t index)
+{
+    auto session = std::make_shared<TcpSession>(*io_services_[index],
+                                                configuration_);
+    auto self(shared_from_this());
+    session->async_accept(*acceptors_[index],
+            [this, self, index, session]
+            (const boost::system::error_code & failure) {
+        on_accept(index, session, failure);
+    });
+}
+
+void
+TcpListener::on_accept(std::size_t index,
+                       const SessionPtr & session,
+                       const boost::system::error_code & failure)
+{
+    // The acceptors are closed once all the connections are accepted.
+    if (failure == ao::error::operation_aborted)
+        return;
+
+    if (failure)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (! failure_)
+                failure_ = failure;
+        }
+        close_acceptors();
+        return;
+    }
+
+    // Connections accepted concurrently by other threads beyond
+    // the count are closed when the session is released.
+    std::size_t const count = ++ accepted_count_;
+    if (count > configuration_.connections)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        sessions_.push_back(session);
+    }
+    session->initialize();
+
+    if (count == configuration_.connections)
+        close_acceptors();
+    else
+        async_accept(index);
+}
+
+void
+TcpListener::close_acceptors()
+{
+    // Each acceptor is closed by the thread running it, the timer
+    // being run by the first one.
+    auto self(shared_from_this());
+    for (std::size_t i = 0, e = acceptors_.size(); i != e; ++i)
+        io_services_[i]->post([this, self, i] {
+            boost::system::error_code failure;
+            acceptors_[i]->close(failure);
+            if (i == 0)
+                accept_timer_.cancel(failure);
+        });
+}
+
+void
+TcpListener::on_accept_timeout(const boost::system::error_code & failure)
+{
+    if (failure == ao::error::operation_aborted ||
+            accepted_count_ >= configuration_.connections)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (! failure_)
+            failure_ = ao::error::timed_out;
+    }
+    close_acceptors();
+}
+
+void
+TcpListener::steer_to_cpu()
+{
+#ifdef __linux__
+    // Select the acceptor whose index is the CPU processing the
+    // connection request, modulo the acceptors count. The acceptors
+    // index in the reuseport group is their listen() order.
+    sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0,
+          std::uint32_t(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0,
+          std::uint32_t(acceptors_.size()) },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    sock_fprog program{};
+    program.len = sizeof(code) / sizeof(code[0]);
+    program.filter = code;
+
+    if (::setsockopt(acceptors_.front()->native_handle(), SOL_SOCKET,
+                     SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0)
+        throw boost::system::system_error{
+                boost::system::error_code{errno,
+                                          boost::system::system_category()},
+                "setsockopt SO_ATTACH_REUSEPORT_CBPF"};
+#else
+    throw std::runtime_error{"--cpu-steering is only supported on Linux"};
+#endif
+}
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,122 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "Results.hpp"
+#include "SessionConfiguration.hpp"
+#include "Socket.hpp"
+#include "TcpSession.hpp"
+
+namespace enyx {
+namespace net_tester {
+
+// Accept the configured count of connections on a single endpoint,
+// each connection being run as a TcpSession.
+//
+// Each thread owns an acceptor bound to the endpoint with SO_REUSEPORT,
+// hence the kernel spreads the connections over the threads and the
+// sessions are run by the io_service of the thread accepting them.
+class TcpListener : public Socket,
+                    public std::enable_shared_from_this<TcpListener>
+{
+public:
+    using IoServices = std::vector<std::shared_ptr<boost::asio::io_service>>;
+
+public:
+    TcpListener(const IoServices & io_services,
+                const SessionConfiguration & configuration);
+
+    TcpListener(const TcpListener &) = delete;
+
+    // Must be called before the threads are started.
+    void
+    start();
+
+    // Print the statistics of each connection followed by the aggregate
+    // ones, and return the first failure.
+    boost::system::error_code
+    finalize();
+
+    // Add a record per connection and their aggregate one to results,
+    // the connections statistics being accumulated into total.
+    void
+    add_results(Results & results, Statistics & total) const;
+
+    // The sessions of the accepted connections, once the threads
+    // are joined.
+    const std::vector<std::shared_ptr<TcpSession>> &
+    get_sessions() const
+    { return sessions_; }
+
+    // The sessions accepted so far, while the threads are running.
+    std::vector<std::shared_ptr<TcpSession>>
+    copy_sessions() const;
+
+private:
+    using SessionPtr = std::shared_ptr<TcpSession>;
+    using AcceptorPtr = std::unique_ptr<TcpSocket::acceptor_type>;
+
+private:
+    void
+    async_accept(std::size_t index);
+
+    void
+    on_accept(std::size_t index,
+              const SessionPtr & session,
+              const boost::system::error_code & failure);
+
+    void
+    close_acceptors();
+
+    void
+    on_accept_timeout(const boost::system::error_code & failure);
+
+    void
+    steer_to_cpu();
+
+private:
+    const IoServices & io_services_;
+    SessionConfiguration configuration_;
+    std::vector<AcceptorPtr> acceptors_;
+    // Run by the first thread, bounds the wait for the connections.
+    boost::asio::deadline_timer accept_timer_;
+    std::atomic<std::size_t> accepted_count_;
+    mutable std::mutex mutex_;
+    std::vector<SessionPtr> sessions_;
+    boost::system::error_code failure_;
+};
+
+} // namespace net_tester
+} // namespace enyx
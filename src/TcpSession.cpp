@@ -44,7 +44,8 @@ TcpSession::TcpSession(boost::asio::io_service & io_service,
     : Session(io_service, configuration),
       socket_(io_service),
       send_handler_memory_(),
-      receive_handler_memory_()
+      receive_handler_memory_(),
+      eof_byte_()
 {
 }
 
@@ -94,7 +95,7 @@ TcpSession::finish_receive()
     auto custom_handler = make_handler(receive_handler_memory_,
                                        std::move(handler));
 
-    auto buffer = boost::asio::buffer(receive_buffer_, 1);
+    auto buffer = boost::asio::buffer(&eof_byte_, 1);
 
     socket_.async_receive(std::move(buffer), std::move(custom_handler));
 }
@@ -132,7 +133,15 @@ TcpSession::async_send(std::size_t slice_remaining_size)
         auto handler = [this, self, slice_remaining_size]
                 (boost::system::error_code const& failure,
                  std::size_t size) {
-            on_send(failure, size, slice_remaining_size);
+            // Too many zerocopy sends are pinning memory,
+            // retry once the kernel released some of them.
+            if (failure == ao::error::no_buffer_space &&
+                    configuration_.zerocopy)
+                wait_zerocopy([this, self, slice_remaining_size] {
+                    async_send(slice_remaining_size);
+                });
+            else
+                on_send(failure, size, slice_remaining_size);
         };
 
         auto custom_handler = make_handler(send_handler_memory_,
@@ -152,14 +161,108 @@ TcpSession::finish_send()
     if (configuration_.shutdown_policy == SessionConfiguration::SEND_COMPLETE)
         socket_.shutdown_send();
 
-    on_send_complete();
+    if (configuration_.zerocopy)
+    {
+        // The send buffer is pinned until all sends are notified.
+        auto self(shared_from_this());
+        wait_zerocopy([this, self] {
+            statistics_.sent_zerocopy_count = socket_.zerocopied_count();
+            statistics_.sent_copied_count = socket_.copied_count();
+            on_send_complete();
+        });
+    }
+    else
+        on_send_complete();
+}
+
+template<typename Handler>
+void
+TcpSession::wait_zerocopy(Handler handler)
+{
+    socket_.async_wait_zerocopy([this, handler]
+            (boost::system::error_code const& failure) mutable {
+        if (failure == ao::error::operation_aborted)
+            return;
+
+        if (failure)
+            abort(failure);
+        else
+            handler();
+    });
+}
+
+void
+TcpSession::async_send_message(const std::uint8_t * data, std::size_t size)
+{
+    send_message(data, size, 0);
+}
+
+void
+TcpSession::send_message(const std::uint8_t * data,
+                         std::size_t size,
+                         std::size_t offset)
+{
+    auto self(shared_from_this());
+    auto handler = [this, self, data, size, offset]
+            (boost::system::error_code const& failure,
+             std::size_t bytes_transferred) {
+        std::size_t const sent = offset + bytes_transferred;
+        if (! failure && sent != size)
+            send_message(data, size, sent);
+        else
+            on_message_sent(failure, sent);
+    };
+
+    auto custom_handler = make_handler(send_handler_memory_,
+                                       std::move(handler));
+
+    auto buffer = boost::asio::buffer(data + offset, size - offset);
+
+    socket_.async_send(std::move(buffer), std::move(custom_handler));
+}
+
+void
+TcpSession::async_receive_message(std::size_t size)
+{
+    receive_message(size, 0);
+}
+
+void
+TcpSession::receive_message(std::size_t size, std::size_t offset)
+{
+    auto self(shared_from_this());
+    auto handler = [this, self, size, offset]
+            (boost::system::error_code const& failure,
+             std::size_t bytes_transferred) {
+        std::size_t const received = offset + bytes_transferred;
+        if (! failure && received != size)
+            receive_message(size, received);
+        else
+            on_message_received(failure, received);
+    };
+
+    auto custom_handler = make_handler(receive_handler_memory_,
+                                       std::move(handler));
+
+    auto buffer = boost::asio::buffer(&receive_buffer_[offset], size - offset);
+
+    socket_.async_receive(std::move(buffer), std::move(custom_handler));
 }
 
 void
 TcpSession::finish()
 {
+    if (auto timestamps = socket_.timestamps())
+        timestamps->finalize(statistics_);
+
     socket_.close();
 }
 
+std::size_t
+TcpSession::get_memory_size() const
+{
+    return Session::get_memory_size() + sizeof(TcpSession) - sizeof(Session);
+}
+
 } // namespace net_tester
 } // namespace enyx
@@ -47,10 +47,30 @@ public:
     {
         Session::initialize();
         auto self(shared_from_this());
-        socket_.open(configuration_, [this, self] { start_transfer(); });
+        // A session accepted by a TcpListener is already connected.
+        if (socket_.is_open())
+            io_service_.post([this, self] { start_transfer(); });
+        else
+            socket_.open(configuration_, [this, self]
+                    (const boost::system::error_code & failure) {
+                if (failure)
+                    abort(failure);
+                else
+                    start_transfer();
+            });
         io_service_.post([this, self] { start_timer(); } );
     }
 
+    // Accept a connection from a listener acceptor, the session
+    // is initialized by the listener once accepted.
+    template<typename OnAcceptHandler>
+    void
+    async_accept(TcpSocket::acceptor_type & acceptor,
+                 OnAcceptHandler on_accept)
+    {
+        socket_.async_accept(acceptor, configuration_, std::move(on_accept));
+    }
+
 protected:
 
     virtual std::shared_ptr<Session>
@@ -75,13 +95,36 @@ protected:
     virtual void
     finish_send() override;
 
+    template<typename Handler>
+    void
+    wait_zerocopy(Handler handler);
+
+    virtual void
+    async_send_message(const std::uint8_t * data, std::size_t size) override;
+
+    virtual void
+    async_receive_message(std::size_t size) override;
+
+    void
+    send_message(const std::uint8_t * data,
+                 std::size_t size,
+                 std::size_t offset);
+
+    void
+    receive_message(std::size_t size, std::size_t offset);
+
     virtual void
     finish() override;
 
+    virtual std::size_t
+    get_memory_size() const override;
+
 private:
     TcpSocket socket_;
     HandlerMemory send_handler_memory_;
     HandlerMemory receive_handler_memory_;
+    // Sending sessions only wait for the peer end of stream.
+    std::uint8_t eof_byte_;
 };
 
 } // namespace net_tester
@@ -24,6 +24,26 @@
 
 #include "TcpSocket.hpp"
 
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+#   include <linux/errqueue.h>
+#   include <netinet/in.h>
+#   include <sys/socket.h>
+#endif
+
+#include <boost/system/system_error.hpp>
+
+#if defined(__linux__) && ! defined(SO_ZEROCOPY)
+#   define SO_ZEROCOPY 60
+#endif
+
+#if defined(__linux__) && ! defined(MSG_ZEROCOPY)
+#   define MSG_ZEROCOPY 0x4000000
+#endif
+
 namespace enyx {
 namespace net_tester {
 
@@ -37,9 +57,153 @@ TcpSocket::shutdown_send()
 void
 TcpSocket::close()
 {
+    if (ring_)
+        ring_->unregister_file(file_);
+
     boost::system::error_code failure;
     socket_.close(failure);
 }
 
+void
+TcpSocket::enable_zerocopy(int descriptor)
+{
+#ifdef __linux__
+    int enabled = 1;
+    if (::setsockopt(descriptor, SOL_SOCKET, SO_ZEROCOPY,
+                     &enabled, sizeof(enabled)) < 0)
+        throw boost::system::system_error{
+                boost::system::error_code{errno,
+                                          boost::system::system_category()},
+                "setsockopt SO_ZEROCOPY"};
+#else
+    (void)descriptor;
+    throw std::runtime_error{"--zerocopy is only supported on Linux"};
+#endif
+}
+
+TcpSocket::socket_type::message_flags
+TcpSocket::zerocopy_flag()
+{
+#ifdef __linux__
+    return MSG_ZEROCOPY;
+#else
+    return 0;
+#endif
+}
+
+void
+TcpSocket::read_zerocopy_notifications()
+{
+#ifdef __linux__
+    for (;;)
+    {
+        char control[CMSG_SPACE(sizeof(sock_extended_err) +
+                                sizeof(sockaddr_in6))];
+        msghdr message{};
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        if (::recvmsg(socket_.native_handle(), &message,
+                      MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // The error queue is drained.
+            break;
+        }
+
+        for (cmsghdr * c = CMSG_FIRSTHDR(&message); c;
+                c = CMSG_NXTHDR(&message, c))
+        {
+            if (! (c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) &&
+                ! (c->cmsg_level == SOL_IPV6 && c->cmsg_type == IPV6_RECVERR))
+                continue;
+
+            sock_extended_err error;
+            std::memcpy(&error, CMSG_DATA(c), sizeof(error));
+            if (error.ee_errno != 0 ||
+                    error.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            // The notification covers the [ee_info, ee_data] sends range.
+            std::uint32_t count = error.ee_data - error.ee_info + 1;
+            if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                copied_count_ += count;
+            else
+                zerocopied_count_ += count;
+
+            for (std::uint32_t id = error.ee_info; id != error.ee_data + 1; ++id)
+            {
+                std::size_t index = id - zerocopy_first_id_;
+                if (index < zerocopy_regions_.size())
+                    zerocopy_regions_[index].is_notified = true;
+            }
+        }
+
+        // Notifications may be received out of order.
+        while (! zerocopy_regions_.empty() &&
+                zerocopy_regions_.front().is_notified)
+        {
+            zerocopy_regions_.pop_front();
+            ++ zerocopy_first_id_;
+        }
+    }
+#endif
+}
+
+void
+TcpSocket::configure(const SessionConfiguration & configuration)
+{
+    if (configuration.engine == SessionConfiguration::IO_URING)
+        ring_ = &boost::asio::use_service<IoUring>(io_service_);
+
+    // Round trips must not wait for Nagle's algorithm.
+    is_no_delay_enabled_ = configuration.workload !=
+                           SessionConfiguration::STREAM;
+    is_zerocopy_enabled_ = configuration.zerocopy;
+    if (configuration.pacing == SessionConfiguration::KERNEL &&
+            configuration.direction != SessionConfiguration::RX)
+        pacing_rate_ = configuration.send_bandwidth;
+    timestamping_ = configuration.timestamping;
+}
+
+boost::system::error_code
+TcpSocket::on_open()
+{
+    if (! socket_.is_open())
+        return boost::system::error_code{};
+
+    if (is_no_delay_enabled_)
+    {
+        boost::system::error_code failure;
+        socket_.set_option(boost::asio::ip::tcp::no_delay(true), failure);
+    }
+
+    try
+    {
+        // Set on both connected and accepted sockets.
+        if (pacing_rate_)
+            set_max_pacing_rate(socket_.native_handle(), pacing_rate_);
+
+        // The send ids are the offsets from the connection establishment.
+        if (timestamping_ != SessionConfiguration::NO_TIMESTAMPING)
+            timestamps_.reset(new KernelTimestamps{io_service_,
+                                                   socket_.native_handle(),
+                                                   true,
+                                                   timestamping_});
+    }
+    catch (const boost::system::system_error & e)
+    {
+        // E.g. the kernel or the NIC doesn't support the option.
+        return e.code();
+    }
+
+    if (ring_)
+        file_ = ring_->register_file(socket_.native_handle());
+
+    return boost::system::error_code{};
+}
+
 } // namespace net_tester
 } // namespace enyx
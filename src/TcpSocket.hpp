@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <iostream>
 
@@ -33,6 +36,8 @@
 
 #include "SessionConfiguration.hpp"
 #include "Socket.hpp"
+#include "IoUring.hpp"
+#include "KernelTimestamps.hpp"
 
 namespace enyx {
 namespace net_tester {
@@ -48,15 +53,30 @@ public:
     explicit
     TcpSocket(boost::asio::io_service & io_service)
         : Socket(io_service),
-          socket_(io_service_)
+          socket_(io_service_),
+          ring_(),
+          file_(),
+          is_no_delay_enabled_(),
+          is_zerocopy_enabled_(),
+          pacing_rate_(),
+          timestamping_(),
+          timestamps_(),
+          zerocopy_regions_(),
+          zerocopy_first_id_(),
+          zerocopied_count_(),
+          copied_count_()
     {
     }
 
+    // on_connect is invoked with the failure to setup the connected
+    // socket.
     template<typename OnConnectHandler>
     void
     open(const SessionConfiguration & configuration,
          OnConnectHandler on_connect)
     {
+        configure(configuration);
+
         switch (configuration.mode)
         {
             default:
@@ -69,20 +89,114 @@ public:
         }
     }
 
+    // Accept a connection from an acceptor shared with other sockets,
+    // on_accept is invoked with the accept outcome.
+    template<typename OnAcceptHandler>
+    void
+    async_accept(acceptor_type & acceptor,
+                 const SessionConfiguration & configuration,
+                 OnAcceptHandler on_accept)
+    {
+        configure(configuration);
+
+        auto handler = [this, on_accept]
+                (const boost::system::error_code & failure) {
+            if (failure)
+                on_accept(failure);
+            else
+                on_accept(on_open());
+        };
+
+        acceptor.async_accept(socket_, std::move(handler));
+    }
+
+    bool
+    is_open() const
+    { return socket_.is_open(); }
+
+    static void
+    enable_zerocopy(int descriptor);
+
     template<typename MutableBufferSequence, typename ReadHandler>
     void
     async_receive(const MutableBufferSequence & buffers, ReadHandler handler)
     {
-        socket_.async_receive(buffers, handler);
+        if (ring_)
+            ring_->async_read(file_,
+                              *boost::asio::buffer_sequence_begin(buffers),
+                              true,
+                              std::move(handler));
+        else if (timestamps_)
+            timestamps_->async_receive(
+                    socket_,
+                    *boost::asio::buffer_sequence_begin(buffers),
+                    static_cast<socket_type::endpoint_type *>(nullptr),
+                    std::move(handler));
+        else
+            socket_.async_receive(buffers, handler);
     }
 
     template<typename ConstBufferSequence, typename WriteHandler>
     void
     async_send(const ConstBufferSequence & buffers, WriteHandler handler)
     {
-        socket_.async_send(buffers, handler);
+        if (ring_)
+            ring_->async_write(file_,
+                               *boost::asio::buffer_sequence_begin(buffers),
+                               std::move(handler));
+        else if (is_zerocopy_enabled_)
+            socket_.async_send(buffers, zerocopy_flag(),
+                               ZeroCopySend<WriteHandler>{
+                                    *this,
+                                    *boost::asio::buffer_sequence_begin(buffers),
+                                    std::move(handler)});
+        else if (timestamps_)
+            socket_.async_send(buffers,
+                               timestamps_->wrap_send(std::move(handler)));
+        else
+            socket_.async_send(buffers, handler);
+    }
+
+    // With --timestamping, null otherwise.
+    KernelTimestamps *
+    timestamps()
+    { return timestamps_.get(); }
+
+    // Invoke the handler once all the zerocopy sends have been
+    // notified, i.e. when the kernel doesn't pin the sent buffers
+    // anymore and they can be rewritten or released.
+    template<typename Handler>
+    void
+    async_wait_zerocopy(Handler handler)
+    {
+        read_zerocopy_notifications();
+
+        if (zerocopy_regions_.empty())
+            io_service_.post([handler]() mutable {
+                handler(boost::system::error_code{});
+            });
+        else
+            // Notifications are queued on the socket error queue.
+            socket_.async_wait(socket_type::wait_error,
+                    [this, handler]
+                    (const boost::system::error_code & failure) mutable {
+                        if (failure)
+                            handler(failure);
+                        else
+                            async_wait_zerocopy(std::move(handler));
+                    });
     }
 
+    // Count of sends notified as performed without copy.
+    std::uint64_t
+    zerocopied_count() const
+    { return zerocopied_count_; }
+
+    // Count of sends the kernel fell back to copy (e.g. on loopback).
+    std::uint64_t
+    copied_count() const
+    { return copied_count_; }
+
     void
     shutdown_send();
 
@@ -102,10 +216,13 @@ private:
         socket_.set_option(reuse_address);
         socket_.bind(e.first);
         setup_windows(configuration, socket_);
+        if (configuration.zerocopy)
+            enable_zerocopy(socket_.native_handle());
 
+        // A connection failure is reported by the first transfer.
         auto handler = [this, on_connect]
-                (const boost::system::error_code & failure) {
-            on_connect();
+                (const boost::system::error_code &) {
+            on_connect(on_open());
         };
 
         socket_.async_connect(e.second, std::move(handler));
@@ -125,20 +242,100 @@ private:
         socket_type::reuse_address reuse_address(true);
         a->set_option(reuse_address);
         setup_windows(configuration, *a);
+        // Accepted sockets inherit SO_ZEROCOPY.
+        if (configuration.zerocopy)
+            enable_zerocopy(a->native_handle());
         a->bind(e.second);
         a->listen();
 
         // Asynchronously Wait for a client to connect.
         auto handler = [this, a, on_connect]
-                (const boost::system::error_code & f) {
-            on_connect();
+                (const boost::system::error_code &) {
+            on_connect(on_open());
         };
 
         a->async_accept(socket_, std::move(handler));
     }
 
+    void
+    configure(const SessionConfiguration & configuration);
+
+    // Return the failure to setup the socket options, as it is invoked
+    // by the reactor threads which must not throw.
+    boost::system::error_code
+    on_open();
+
+    // A buffer region pinned by a zerocopy send until notified.
+    struct ZeroCopyRegion
+    {
+        const void * data;
+        std::size_t size;
+        bool is_notified;
+    };
+
+    template<typename Handler>
+    class ZeroCopySend
+    {
+    public:
+        using allocator_type = boost::asio::associated_allocator_t<Handler>;
+
+    public:
+        ZeroCopySend(TcpSocket & socket,
+                     const boost::asio::const_buffer & buffer,
+                     Handler handler)
+            : socket_(socket),
+              data_(buffer.data()),
+              handler_(std::move(handler))
+        { }
+
+        allocator_type
+        get_allocator() const noexcept
+        {
+            return boost::asio::get_associated_allocator(handler_);
+        }
+
+        void
+        operator()(const boost::system::error_code & failure,
+                   std::size_t bytes_transferred)
+        {
+            // Each successful send is assigned the next notification id.
+            if (! failure && bytes_transferred)
+                socket_.zerocopy_regions_.push_back(
+                        ZeroCopyRegion{data_, bytes_transferred, false});
+
+            // Release the regions the kernel is done with, otherwise
+            // they and their notifications would accumulate until the
+            // socket optmem is exhausted.
+            socket_.read_zerocopy_notifications();
+
+            handler_(failure, bytes_transferred);
+        }
+
+    private:
+        TcpSocket & socket_;
+        const void * data_;
+        Handler handler_;
+    };
+
+    static socket_type::message_flags
+    zerocopy_flag();
+
+    void
+    read_zerocopy_notifications();
+
 private:
     socket_type socket_;
+    IoUring * ring_;
+    IoUring::File file_;
+    bool is_no_delay_enabled_;
+    bool is_zerocopy_enabled_;
+    std::uint64_t pacing_rate_;
+    SessionConfiguration::Timestamping timestamping_;
+    std::unique_ptr<KernelTimestamps> timestamps_;
+    std::deque<ZeroCopyRegion> zerocopy_regions_;
+    std::uint32_t zerocopy_first_id_;
+    std::uint64_t zerocopied_count_;
+    std::uint64_t copied_count_;
 };
 
 } // namespace net_tester
@@ -24,6 +24,9 @@
 
 #include "UdpSession.hpp"
 
+#include <array>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 
 #include <boost/bind.hpp>
@@ -34,25 +37,133 @@
 #include "Error.hpp"
 #include "Socket.hpp"
 #include "Statistics.hpp"
+#include "Verify.hpp"
 
 namespace enyx {
 namespace net_tester {
 
+namespace {
+
+// Maximum count of segments per GSO send (UDP_MAX_SEGMENTS).
+constexpr std::size_t MAX_GSO_SEGMENTS = 64;
+
+// Maximum UDP payload, a GSO send must fit in a single IP datagram.
+constexpr std::size_t MAX_GSO_SIZE = 65507;
+
+// Maximum size of a datagram coalesced by GRO.
+constexpr std::size_t MAX_GRO_SIZE = 65536;
+
+std::size_t
+count_segments(std::size_t size, std::size_t segment_size)
+{
+    if (! segment_size || size <= segment_size)
+        return 1;
+
+    return (size + segment_size - 1) / segment_size;
+}
+
+std::uint64_t
+now_ns()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::uint64_t(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+} // anonymous namespace
+
 UdpSession::UdpSession(boost::asio::io_service & io_service,
-                       const SessionConfiguration & configuration)
+                       const SessionConfiguration & configuration,
+                       std::shared_ptr<ReceiveGroup> group)
     : Session(io_service, configuration),
       socket_(io_service, configuration),
       send_handler_memory_(),
       receive_handler_memory_(),
       random_generator_(std::random_device{}()),
       distribution_{configuration_.packet_size.low(),
-                    configuration_.packet_size.high()}
+                    configuration_.packet_size.high()},
+      send_datagrams_(),
+      receive_datagrams_(),
+      receive_slot_size_(is_gro_enabled(configuration) ?
+                                MAX_GRO_SIZE :
+                                std::size_t(configuration.packet_size.high())),
+      gso_segment_size_(is_gso_enabled(configuration) ?
+                                std::size_t(configuration.packet_size.high()) :
+                                0),
+      send_headers_(),
+      send_header_buffers_(),
+      next_sequence_(),
+      session_id_(std::uint32_t(random_generator_())),
+      peer_session_id_(),
+      is_peer_session_known_(),
+      group_(std::move(group)),
+      is_reflector_(configuration.mode == SessionConfiguration::SERVER &&
+                    configuration.direction == SessionConfiguration::BOTH),
+      is_peer_endpoint_known_(configuration.mode ==
+                              SessionConfiguration::CLIENT),
+      peer_probe_(),
+      last_datagram_sent_()
+{
+    if (configuration_.sequence_header)
+    {
+        send_headers_.resize(configuration_.batch_size);
+        send_header_buffers_.reserve(configuration_.batch_size);
+    }
+
+    if (configuration_.batch_size > 1 || is_gro_enabled(configuration_))
+    {
+        send_datagrams_.reserve(configuration_.batch_size);
+
+        // Each batched datagram is received in its own slot,
+        // only allocated when receiving.
+        if (configuration_.direction != SessionConfiguration::TX)
+        {
+            receive_datagrams_.reserve(configuration_.batch_size);
+            receive_buffer_.resize(std::max<std::size_t>(BUFFER_SIZE,
+                    configuration_.batch_size * receive_slot_size_));
+        }
+    }
+}
+
+void
+UdpSession::initialize()
 {
+    Session::initialize();
+    auto self(shared_from_this());
+
+    if (group_)
+    {
+        // Wake up this session from the thread completing the group.
+        std::weak_ptr<UdpSession> member = self;
+        auto & io_service = io_service_;
+        group_->join([&io_service, member] {
+            io_service.post([member] {
+                if (auto session = member.lock())
+                    session->on_group_complete();
+            });
+        });
+    }
+
+    io_service_.post([this, self] {
+        start_timer();
+        start_transfer();
+
+        // A listening source only knows where to send once
+        // it receives a datagram.
+        if (configuration_.announce)
+            announce();
+    });
 }
 
 void
 UdpSession::async_receive(std::size_t slice_remaining_size)
 {
+    // The group may have been completed by the other members.
+    if (is_receive_complete_)
+        return;
+    if (group_ && group_->is_complete())
+        return finish_receive();
+
     auto self(shared_from_this());
     // If we've sent all data allowed within the current slice.
     if (slice_remaining_size == 0)
@@ -60,19 +171,33 @@ UdpSession::async_receive(std::size_t slice_remaining_size)
         // when the next slice will start with a slice_remaining_size
         // set as required by bandwidth.
         receive_throttle_.delay([this, self](std::size_t s){ async_receive(s); });
+    else if (configuration_.batch_size > 1 || is_gro_enabled(configuration_))
+        async_receive_batch(slice_remaining_size);
+    else if (is_reflector_)
+        async_receive_reflect(slice_remaining_size);
     else
     {
-        auto handler = [this, self, slice_remaining_size]
+        // A listening session receives datagrams whole, even if they
+        // overflow the slice, as its peers (e.g. any client) may cut
+        // their datagrams on other boundaries.
+        bool const is_listening = configuration_.mode ==
+                                  SessionConfiguration::SERVER;
+        auto handler = [this, self, slice_remaining_size, is_listening]
                 (boost::system::error_code const& failure,
                  std::size_t size) {
-            on_receive(failure, size, slice_remaining_size);
+            if (! failure)
+                ++ statistics_.received_datagrams_count;
+            on_receive(failure, size, is_listening ?
+                                      std::max(slice_remaining_size, size) :
+                                      slice_remaining_size);
         };
 
         auto custom_handler = make_handler(receive_handler_memory_,
                                            std::move(handler));
 
-        auto buffer = boost::asio::buffer(receive_buffer_,
-                                          slice_remaining_size);
+        auto buffer = is_listening ?
+                boost::asio::buffer(receive_buffer_) :
+                boost::asio::buffer(receive_buffer_, slice_remaining_size);
 
         socket_.async_receive(std::move(buffer), std::move(custom_handler));
     }
@@ -82,42 +207,419 @@ void
 UdpSession::finish_receive()
 {
     Session::finish_receive();
+
+    // The reflected datagrams are sent as received.
+    if (is_reflector_)
+        finish_send();
+
     on_receive_complete();
 }
 
 void
 UdpSession::async_send(std::size_t slice_remaining_size)
 {
+    if (is_reflector_)
+        return;
+
     auto self(shared_from_this());
     if (slice_remaining_size == 0)
         send_throttle_.delay([this, self](std::size_t s){ async_send(s); });
+    else if (! is_peer_endpoint_known_)
+        wait_for_peer(slice_remaining_size);
+    else if (configuration_.batch_size > 1)
+        async_send_batch(slice_remaining_size);
     else
     {
         std::size_t const remaining_size = configuration_.size -
                                            statistics_.sent_bytes_count;
 
-        slice_remaining_size = std::min(slice_remaining_size, remaining_size);
         std::size_t const offset = std::uint8_t(statistics_.sent_bytes_count);
-        std::size_t const datagram_size = std::min(slice_remaining_size,
-                                                   get_max_datagram_size());
+        std::size_t const datagram_size = std::min(
+                get_slice_bytes_count(slice_remaining_size, remaining_size),
+                get_send_datagram_size());
         assert(datagram_size <= BUFFER_SIZE - offset);
 
         auto handler = [this, self, slice_remaining_size]
                 (boost::system::error_code const& failure,
                  std::size_t size) {
+            if (! failure)
+            {
+                count_sent_datagrams(size);
+                if (configuration_.sequence_header)
+                    ++ next_sequence_;
+            }
             on_send(failure, size, slice_remaining_size);
         };
 
         auto custom_handler =  make_handler(send_handler_memory_,
                                             std::move(handler));
 
-        auto buffer = boost::asio::buffer(&send_buffer_[offset],
-                                          datagram_size);
+        if (configuration_.sequence_header)
+        {
+            std::array<boost::asio::const_buffer, 2> buffers{{
+                    prepare_send_header(0, now_ns()),
+                    get_sequence_payload(0, datagram_size)}};
+
+            socket_.async_send(buffers, std::move(custom_handler));
+        }
+        else
+        {
+            auto buffer = boost::asio::buffer(send_buffer_ + offset,
+                                              datagram_size);
 
-        socket_.async_send(std::move(buffer), std::move(custom_handler));
+            socket_.async_send(std::move(buffer), std::move(custom_handler));
+        }
     }
 }
 
+void
+UdpSession::async_receive_batch(std::size_t slice_remaining_size)
+{
+    receive_datagrams_.clear();
+    for (std::size_t i = 0; i != configuration_.batch_size; ++i)
+        receive_datagrams_.push_back(boost::asio::buffer(
+                &receive_buffer_[i * receive_slot_size_], receive_slot_size_));
+
+    auto self(shared_from_this());
+    auto handler = [this, self, slice_remaining_size]
+            (boost::system::error_code const& failure,
+             std::size_t datagrams_count) {
+        if (failure)
+            return on_receive(failure, 0, slice_remaining_size);
+
+        std::size_t size = 0;
+        for (std::size_t i = 0; i != datagrams_count; ++i)
+        {
+            auto const& datagram = receive_datagrams_[i];
+            process_received(static_cast<const std::uint8_t *>(datagram.data()),
+                             datagram.size());
+            size += datagram.size();
+
+            // Account the logical datagrams coalesced by GRO.
+            std::size_t segment_size = socket_.received_segment_size(i);
+            std::size_t segments = count_segments(datagram.size(),
+                                                  segment_size);
+            statistics_.received_datagrams_count += segments;
+            if (is_gro_enabled(configuration_))
+                statistics_.receive_segments_counts.add(segments);
+        }
+
+        if (configuration_.batch_size > 1)
+            statistics_.receive_batch_sizes.add(datagrams_count);
+
+        if (is_reflector_)
+            reflect_batch(datagrams_count, size, slice_remaining_size);
+        else
+            receive_next(slice_remaining_size - std::min(size,
+                                                         slice_remaining_size));
+    };
+
+    auto custom_handler = make_handler(receive_handler_memory_,
+                                       std::move(handler));
+
+    socket_.async_receive_batch(receive_datagrams_, std::move(custom_handler));
+}
+
+void
+UdpSession::async_send_batch(std::size_t slice_remaining_size)
+{
+    std::size_t const remaining_size = configuration_.size -
+                                       statistics_.sent_bytes_count;
+
+    std::size_t const slice_size = get_slice_bytes_count(slice_remaining_size,
+                                                         remaining_size);
+    std::size_t const slice_datagrams_count = configuration_.send_rate ?
+            std::min(slice_remaining_size, configuration_.batch_size) :
+            configuration_.batch_size;
+
+    // Cut the slice into datagrams, each one starting
+    // with the byte expected by the peer.
+    send_datagrams_.clear();
+    send_header_buffers_.clear();
+    std::uint64_t const timestamp = configuration_.sequence_header ?
+                                    now_ns() : 0;
+    std::size_t batch_size = 0;
+    while (send_datagrams_.size() != slice_datagrams_count &&
+           batch_size < slice_size)
+    {
+        std::size_t const offset = std::uint8_t(statistics_.sent_bytes_count +
+                                                batch_size);
+        std::size_t const datagram_size = std::min(slice_size - batch_size,
+                                                   get_send_datagram_size());
+        assert(datagram_size <= BUFFER_SIZE - offset);
+
+        if (configuration_.sequence_header)
+        {
+            std::size_t const index = send_datagrams_.size();
+            auto header = prepare_send_header(index, timestamp);
+            auto payload = get_sequence_payload(index, datagram_size);
+            send_header_buffers_.push_back(header);
+            send_datagrams_.push_back(payload);
+            batch_size += header.size() + payload.size();
+        }
+        else
+        {
+            send_datagrams_.push_back(get_send_payload(offset, datagram_size));
+            batch_size += datagram_size;
+        }
+    }
+
+    auto self(shared_from_this());
+    auto handler = [this, self, slice_remaining_size]
+            (boost::system::error_code const& failure,
+             std::size_t datagrams_count) {
+        std::size_t size = 0;
+        for (std::size_t i = 0; i != datagrams_count; ++i)
+        {
+            std::size_t datagram_size = send_datagrams_[i].size();
+            if (configuration_.sequence_header)
+                datagram_size += SequenceHeader::SIZE;
+
+            size += datagram_size;
+            count_sent_datagrams(datagram_size);
+        }
+
+        if (! failure)
+            statistics_.send_batch_sizes.add(datagrams_count);
+
+        // Unsent datagrams sequence numbers are reused by the next batch.
+        next_sequence_ += datagrams_count;
+
+        on_send(failure, size, slice_remaining_size, datagrams_count);
+    };
+
+    auto custom_handler = make_handler(send_handler_memory_,
+                                       std::move(handler));
+
+    if (configuration_.sequence_header)
+        socket_.async_send_batch(send_header_buffers_, send_datagrams_,
+                                 std::move(custom_handler));
+    else
+        socket_.async_send_batch(send_datagrams_, std::move(custom_handler));
+}
+
+void
+UdpSession::async_receive_reflect(std::size_t slice_remaining_size)
+{
+    auto self(shared_from_this());
+    auto handler = [this, self, slice_remaining_size]
+            (boost::system::error_code const& failure,
+             std::size_t size) {
+        if (failure)
+            return on_receive(failure, 0, slice_remaining_size);
+
+        ++ statistics_.received_datagrams_count;
+        process_received(receive_buffer_.data(), size);
+
+        auto reflected = [this, self, size, slice_remaining_size]
+                (boost::system::error_code const& failure, std::size_t) {
+            on_reflected(failure, 1, size, slice_remaining_size);
+        };
+
+        socket_.async_reflect(boost::asio::buffer(receive_buffer_, size),
+                              make_handler(send_handler_memory_,
+                                           std::move(reflected)));
+    };
+
+    auto custom_handler = make_handler(receive_handler_memory_,
+                                       std::move(handler));
+
+    // Datagrams are received whole to be reflected as is.
+    socket_.async_receive(boost::asio::buffer(receive_buffer_),
+                          std::move(custom_handler));
+}
+
+void
+UdpSession::reflect_batch(std::size_t datagrams_count,
+                          std::size_t received_size,
+                          std::size_t slice_remaining_size)
+{
+    receive_datagrams_.resize(datagrams_count);
+
+    auto self(shared_from_this());
+    auto handler = [this, self, received_size, slice_remaining_size]
+            (boost::system::error_code const& failure,
+             std::size_t datagrams_count) {
+        on_reflected(failure, datagrams_count, received_size,
+                     slice_remaining_size);
+    };
+
+    socket_.async_reflect_batch(receive_datagrams_,
+                                make_handler(send_handler_memory_,
+                                             std::move(handler)));
+}
+
+void
+UdpSession::on_reflected(const boost::system::error_code & failure,
+                         std::size_t datagrams_count,
+                         std::size_t received_size,
+                         std::size_t slice_remaining_size)
+{
+    if (failure == boost::asio::error::operation_aborted)
+        return;
+
+    if (failure)
+        return abort(failure);
+
+    // The datagrams received last are the ones reflected.
+    std::size_t size = 0;
+    if (configuration_.batch_size > 1)
+    {
+        for (std::size_t i = 0; i != datagrams_count; ++i)
+        {
+            size += receive_datagrams_[i].size();
+            count_sent_datagrams(receive_datagrams_[i].size());
+        }
+        statistics_.send_batch_sizes.add(datagrams_count);
+    }
+    else
+    {
+        size = received_size;
+        count_sent_datagrams(size);
+    }
+
+    statistics_.sent_bytes_count += size;
+
+    receive_next(slice_remaining_size - std::min(received_size,
+                                                 slice_remaining_size));
+}
+
+void
+UdpSession::announce()
+{
+    auto self(shared_from_this());
+    auto handler = [this, self]
+            (boost::system::error_code const& failure, std::size_t) {
+        if (failure && failure != boost::asio::error::operation_aborted)
+            abort(failure);
+    };
+
+    socket_.async_send(boost::asio::buffer(send_buffer_, 0),
+                       make_handler(send_handler_memory_, std::move(handler)));
+}
+
+void
+UdpSession::wait_for_peer(std::size_t slice_remaining_size)
+{
+    auto self(shared_from_this());
+    auto handler = [this, self, slice_remaining_size]
+            (boost::system::error_code const& failure, std::size_t) {
+        if (failure == boost::asio::error::operation_aborted)
+            return;
+
+        // A truncated datagram is reported as an error on Windows.
+        if (failure && failure != boost::asio::error::message_size)
+            return abort(failure);
+
+        socket_.set_peer_endpoint(socket_.sender_endpoint());
+        is_peer_endpoint_known_ = true;
+        async_send(slice_remaining_size);
+    };
+
+    socket_.async_receive(boost::asio::buffer(&peer_probe_, 1),
+                          make_handler(receive_handler_memory_,
+                                       std::move(handler)));
+}
+
+void
+UdpSession::on_group_complete()
+{
+    if (is_receive_complete_)
+        return;
+
+    // Abort the pending operations, whose handlers ignore
+    // the cancellation.
+    socket_.cancel();
+    finish_receive();
+}
+
+boost::asio::const_buffer
+UdpSession::prepare_send_header(std::size_t index, std::uint64_t timestamp)
+{
+    SequenceHeader & header = send_headers_[index];
+    header.sequence = next_sequence_ + index;
+    header.session_id = session_id_;
+    header.reserved = 0;
+    header.timestamp = timestamp;
+
+    return boost::asio::buffer(&header, SequenceHeader::SIZE);
+}
+
+boost::asio::const_buffer
+UdpSession::get_sequence_payload(std::size_t index,
+                                 std::size_t datagram_size)
+{
+    // The datagram header isn't split even if the slice is exhausted.
+    std::size_t const size = std::max<std::size_t>(datagram_size,
+                                                   SequenceHeader::SIZE) -
+                             SequenceHeader::SIZE;
+
+    // The payload pattern starts from the sequence number of the
+    // header, so it can be verified regardless of the losses.
+    std::uint64_t const sequence = next_sequence_ + index;
+    return get_send_payload(std::uint8_t(sequence), size);
+}
+
+void
+UdpSession::process_received(const std::uint8_t * data, std::size_t size)
+{
+    if (group_)
+        group_->add(size);
+
+    if (! configuration_.sequence_header)
+        return Session::process_received(data, size);
+
+    if (size < SequenceHeader::SIZE)
+    {
+        std::cerr << "Truncated datagram of " << size << " bytes"
+                  << " on session " << configuration_.endpoint
+                  << "." << std::endl;
+        abort(error::data_mismatch);
+        return;
+    }
+
+    SequenceHeader header;
+    std::memcpy(&header, data, SequenceHeader::SIZE);
+
+    if (! is_peer_session_known_)
+    {
+        peer_session_id_ = header.session_id;
+        is_peer_session_known_ = true;
+    }
+
+    if (header.session_id != peer_session_id_)
+        statistics_.received_sequences.add_foreign();
+    else
+    {
+        statistics_.received_sequences.add(header.sequence);
+
+        // Verify the payload.
+        const std::uint8_t * payload = data + SequenceHeader::SIZE;
+        std::size_t const payload_size = size - SequenceHeader::SIZE;
+        std::uint8_t expected_byte = std::uint8_t(header.sequence);
+        switch (configuration_.verify)
+        {
+        default:
+        case SessionConfiguration::NONE:
+            break;
+        case SessionConfiguration::FIRST:
+            if (payload_size)
+                verify(payload, 0, expected_byte);
+            break;
+        case SessionConfiguration::ALL:
+            {
+                std::size_t i = find_pattern_mismatch(payload, payload_size,
+                                                      expected_byte);
+                if (i != payload_size)
+                    verify(payload, i, std::uint8_t(expected_byte + i));
+            }
+            break;
+        }
+    }
+
+    statistics_.received_bytes_count += size;
+}
+
 void
 UdpSession::finish_send()
 {
@@ -125,12 +627,110 @@ UdpSession::finish_send()
     on_send_complete();
 }
 
+void
+UdpSession::async_send_message(const std::uint8_t * data, std::size_t size)
+{
+    auto self(shared_from_this());
+    auto handler = [this, self]
+            (boost::system::error_code const& failure,
+             std::size_t bytes_transferred) {
+        if (! failure)
+            ++ statistics_.sent_datagrams_count;
+        on_message_sent(failure, bytes_transferred);
+    };
+
+    auto custom_handler = make_handler(send_handler_memory_,
+                                       std::move(handler));
+
+    socket_.async_send(boost::asio::buffer(data, size),
+                       std::move(custom_handler));
+}
+
+void
+UdpSession::async_receive_message(std::size_t size)
+{
+    auto self(shared_from_this());
+    auto handler = [this, self]
+            (boost::system::error_code const& failure,
+             std::size_t bytes_transferred) {
+        if (! failure)
+            ++ statistics_.received_datagrams_count;
+        on_message_received(failure, bytes_transferred);
+    };
+
+    auto custom_handler = make_handler(receive_handler_memory_,
+                                       std::move(handler));
+
+    socket_.async_receive(boost::asio::buffer(receive_buffer_, size),
+                          std::move(custom_handler));
+}
+
 void
 UdpSession::finish()
 {
+    if (auto timestamps = socket_.timestamps())
+        timestamps->finalize(statistics_);
+
     socket_.close();
 }
 
+boost::asio::const_buffer
+UdpSession::get_send_payload(std::size_t offset, std::size_t size)
+{
+    return boost::asio::buffer(send_buffer_ + offset, size);
+}
+
+std::size_t
+UdpSession::get_memory_size() const
+{
+    return Session::get_memory_size() + sizeof(UdpSession) - sizeof(Session) +
+           (send_datagrams_.capacity() + receive_datagrams_.capacity() +
+            send_header_buffers_.capacity()) *
+                sizeof(UdpSocket::Datagrams::value_type) +
+           send_headers_.capacity() * sizeof(SequenceHeader);
+}
+
+std::size_t
+UdpSession::get_send_datagram_size()
+{
+    if (! gso_segment_size_)
+        return get_max_datagram_size();
+
+    // Send as many segments as a single GSO send accepts.
+    return gso_segment_size_ * std::min(MAX_GSO_SEGMENTS,
+                                        MAX_GSO_SIZE / gso_segment_size_);
+}
+
+std::size_t
+UdpSession::get_slice_bytes_count(std::size_t slice_remaining_size,
+                                  std::size_t remaining_size) const
+{
+    // With --tx-rate, the slice counts datagrams.
+    if (configuration_.send_rate)
+        return remaining_size;
+
+    return std::min(slice_remaining_size, remaining_size);
+}
+
+void
+UdpSession::count_sent_datagrams(std::size_t size)
+{
+    if (configuration_.send_rate)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        if (last_datagram_sent_ != std::chrono::steady_clock::time_point{})
+            statistics_.sent_datagram_gaps.record(std::uint64_t(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            now - last_datagram_sent_).count()));
+        last_datagram_sent_ = now;
+    }
+
+    std::size_t segments = count_segments(size, gso_segment_size_);
+    statistics_.sent_datagrams_count += segments;
+    if (gso_segment_size_)
+        statistics_.send_segments_counts.add(segments);
+}
+
 std::size_t
 UdpSession::get_max_datagram_size()
 {
@@ -24,12 +24,17 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "Session.hpp"
 #include "UdpSocket.hpp"
 #include "HandlerAllocator.hpp"
+#include "Sequence.hpp"
+#include "ReceiveGroup.hpp"
 
 namespace enyx {
 namespace net_tester {
@@ -38,18 +43,11 @@ class UdpSession : public Session, public std::enable_shared_from_this<UdpSessio
 {
 public:
     UdpSession(boost::asio::io_service & io_service,
-               const SessionConfiguration & configuration);
+               const SessionConfiguration & configuration,
+               std::shared_ptr<ReceiveGroup> group = nullptr);
 
     virtual void
-    initialize() override
-    {
-        Session::initialize();
-        auto self(shared_from_this());
-        io_service_.post([this, self] {
-            start_timer();
-            start_transfer();
-        });
-    }
+    initialize() override;
 
 protected:
 
@@ -74,15 +72,93 @@ protected:
     virtual void
     finish() override;
 
+    virtual void
+    async_send_message(const std::uint8_t * data, std::size_t size) override;
+
+    virtual void
+    async_receive_message(std::size_t size) override;
+
+    void
+    async_receive_batch(std::size_t slice_remaining_size);
+
+    void
+    async_send_batch(std::size_t slice_remaining_size);
+
+    void
+    async_receive_reflect(std::size_t slice_remaining_size);
+
+    void
+    reflect_batch(std::size_t datagrams_count,
+                  std::size_t received_size,
+                  std::size_t slice_remaining_size);
+
+    void
+    on_reflected(const boost::system::error_code & failure,
+                 std::size_t datagrams_count,
+                 std::size_t received_size,
+                 std::size_t slice_remaining_size);
+
+    void
+    announce();
+
+    void
+    wait_for_peer(std::size_t slice_remaining_size);
+
+    void
+    on_group_complete();
+
+    virtual void
+    process_received(const std::uint8_t * data, std::size_t size) override;
+
+    std::size_t
+    get_send_datagram_size();
+
+    boost::asio::const_buffer
+    prepare_send_header(std::size_t index, std::uint64_t timestamp);
+
+    boost::asio::const_buffer
+    get_sequence_payload(std::size_t index, std::size_t datagram_size);
+
+    std::size_t
+    get_slice_bytes_count(std::size_t slice_remaining_size,
+                          std::size_t remaining_size) const;
+
+    void
+    count_sent_datagrams(std::size_t size);
+
     std::size_t
     get_max_datagram_size();
 
+    // The send pattern is shared read-only by all the sessions.
+    boost::asio::const_buffer
+    get_send_payload(std::size_t offset, std::size_t size);
+
+    virtual std::size_t
+    get_memory_size() const override;
+
 private:
     UdpSocket socket_;
     HandlerMemory send_handler_memory_;
     HandlerMemory receive_handler_memory_;
     std::mt19937 random_generator_;
     std::uniform_int_distribution<std::size_t> distribution_;
+    UdpSocket::ConstDatagrams send_datagrams_;
+    UdpSocket::Datagrams receive_datagrams_;
+    std::size_t receive_slot_size_;
+    std::size_t gso_segment_size_;
+    std::vector<SequenceHeader> send_headers_;
+    UdpSocket::ConstDatagrams send_header_buffers_;
+    std::uint64_t next_sequence_;
+    std::uint32_t session_id_;
+    std::uint32_t peer_session_id_;
+    bool is_peer_session_known_;
+    std::shared_ptr<ReceiveGroup> group_;
+    // A listening session in both mode echoes each datagram back
+    // to its sender.
+    bool is_reflector_;
+    bool is_peer_endpoint_known_;
+    std::uint8_t peer_probe_;
+    std::chrono::steady_clock::time_point last_datagram_sent_;
 };
 
 } // namespace net_tester
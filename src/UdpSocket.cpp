@@ -24,11 +24,29 @@
 
 #include "UdpSocket.hpp"
 
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/system/system_error.hpp>
 
 namespace enyx {
 namespace net_tester {
@@ -36,24 +54,86 @@ namespace net_tester {
 namespace ao = boost::asio;
 namespace pt = boost::posix_time;
 
+namespace {
+
+// Room for the ancillary data of each received datagram.
+constexpr std::size_t CONTROL_SIZE = 128;
+
+void
+set_udp_option(UdpSocket::socket_type & socket, int name, int value)
+{
+#ifdef __linux__
+    if (::setsockopt(socket.native_handle(), SOL_UDP, name,
+                     &value, sizeof(value)) < 0)
+        throw boost::system::system_error{
+                boost::system::error_code{errno,
+                                          boost::system::system_category()},
+                "setsockopt"};
+#else
+    throw std::runtime_error{"--offload is only supported on Linux"};
+#endif
+}
+
+} // anonymous namespace
+
+struct UdpSocket::Batch
+{
+#ifdef __linux__
+    explicit
+    Batch(std::size_t capacity)
+        : messages(capacity),
+          iovecs(2 * capacity),
+          controls(capacity * CONTROL_SIZE),
+          segment_sizes(capacity),
+          senders(capacity),
+          datagrams(),
+          size()
+    { }
+
+    std::vector<mmsghdr> messages;
+    std::vector<iovec> iovecs;
+    std::vector<char> controls;
+    std::vector<std::size_t> segment_sizes;
+    std::vector<UdpSocket::endpoint_type> senders;
+#else
+    explicit
+    Batch(std::size_t)
+        : datagrams(),
+          size()
+    { }
+#endif
+    Datagrams * datagrams;
+    std::size_t size;
+};
+
 UdpSocket::UdpSocket(boost::asio::io_service & io_service,
                      const SessionConfiguration & configuration)
     : Socket(io_service),
       socket_(io_service_),
-      discarded_endpoint_(),
-      peer_endpoint_()
+      sender_endpoint_(),
+      peer_endpoint_(),
+      ring_(),
+      file_(),
+      send_batch_(),
+      receive_batch_(),
+      timestamps_()
 {
     switch (configuration.mode)
     {
         default:
         case SessionConfiguration::SERVER:
-            throw std::runtime_error{"Udp supports client mode only"};
+            listen(configuration);
+            break;
         case SessionConfiguration::CLIENT:
             connect(configuration);
             break;
     }
 }
 
+UdpSocket::~UdpSocket()
+{
+}
+
 void
 UdpSocket::connect(const SessionConfiguration & configuration)
 {
@@ -70,11 +150,236 @@ UdpSocket::connect(const SessionConfiguration & configuration)
 
     // Set the default destination address of this datagram socket.
     peer_endpoint_ = e.second;
+
+    if (configuration.engine == SessionConfiguration::IO_URING)
+    {
+        // The ring reads and writes the socket, hence
+        // the peer must be set at socket level.
+        socket_.connect(peer_endpoint_);
+
+        ring_ = &ao::use_service<IoUring>(io_service_);
+        file_ = ring_->register_file(socket_.native_handle());
+    }
+
+    setup(configuration);
+}
+
+void
+UdpSocket::listen(const SessionConfiguration & configuration)
+{
+    const auto e = resolve<protocol_type>(configuration.endpoint);
+
+    socket_.open(e.second.protocol());
+
+    setup_windows(configuration, socket_);
+
+    ao::socket_base::reuse_address reuse_address(true);
+    socket_.set_option(reuse_address);
+
+    // The kernel spreads the peers over the sockets bound to the port.
+    if (configuration.reuse_port)
+    {
+#ifdef SO_REUSEPORT
+        using reuse_port = ao::detail::socket_option::boolean<SOL_SOCKET,
+                                                              SO_REUSEPORT>;
+        socket_.set_option(reuse_port{true});
+#else
+        throw std::runtime_error{"--reuse-port isn't supported"};
+#endif
+    }
+
+    // The peers are only known from the datagrams received.
+    socket_.bind(e.second);
+
+    setup(configuration);
+}
+
+void
+UdpSocket::setup(const SessionConfiguration & configuration)
+{
+    if (is_gso_enabled(configuration))
+        // Each datagram sent is segmented by the kernel (or the NIC).
+        set_udp_option(socket_, UDP_SEGMENT,
+                       int(configuration.packet_size.high()));
+
+    if (is_gro_enabled(configuration))
+        set_udp_option(socket_, UDP_GRO, 1);
+
+    setup_pacing(configuration, socket_);
+
+    if (configuration.timestamping != SessionConfiguration::NO_TIMESTAMPING)
+        timestamps_.reset(new KernelTimestamps{io_service_,
+                                               socket_.native_handle(),
+                                               false,
+                                               configuration.timestamping});
+
+    // GRO segment size is only available from ancillary data,
+    // hence received with recvmmsg().
+    if (configuration.batch_size > 1 || is_gro_enabled(configuration))
+    {
+#ifndef __linux__
+        throw std::runtime_error{"--batch-size is only supported on Linux"};
+#endif
+        send_batch_.reset(new Batch{configuration.batch_size});
+        receive_batch_.reset(new Batch{configuration.batch_size});
+
+        // sendmmsg() and recvmmsg() must never block the reactor.
+        socket_.non_blocking(true);
+    }
+}
+
+void
+UdpSocket::prepare_batch(const ConstDatagrams & datagrams,
+                         const ConstDatagrams * headers)
+{
+    send_batch_->datagrams = nullptr;
+    prepare_messages(BATCH_SEND, datagrams, headers);
+}
+
+void
+UdpSocket::prepare_batch(BatchDirection direction, Datagrams & datagrams)
+{
+    Batch & batch = direction == BATCH_RECEIVE ? *receive_batch_ : *send_batch_;
+
+    // Received datagrams are shrunk to their size.
+    batch.datagrams = &datagrams;
+    prepare_messages(direction, datagrams, nullptr);
+}
+
+template<typename Buffers>
+void
+UdpSocket::prepare_messages(BatchDirection direction,
+                            const Buffers & datagrams,
+                            const ConstDatagrams * headers)
+{
+    Batch & batch = direction == BATCH_RECEIVE ? *receive_batch_ : *send_batch_;
+
+    batch.size = datagrams.size();
+
+#ifdef __linux__
+    assert(batch.size <= batch.messages.size());
+
+    for (std::size_t i = 0; i != batch.size; ++i)
+    {
+        iovec * v = &batch.iovecs[2 * i];
+        msghdr & m = batch.messages[i].msg_hdr;
+        m = msghdr{};
+        m.msg_iov = v;
+
+        if (headers)
+        {
+            // iovec is shared with recvmsg(), sendmmsg() doesn't write.
+            v[m.msg_iovlen].iov_base = const_cast<void *>((*headers)[i].data());
+            v[m.msg_iovlen].iov_len = (*headers)[i].size();
+            ++ m.msg_iovlen;
+        }
+
+        v[m.msg_iovlen].iov_base = const_cast<void *>(
+                static_cast<const void *>(datagrams[i].data()));
+        v[m.msg_iovlen].iov_len = datagrams[i].size();
+        ++ m.msg_iovlen;
+
+        if (direction == BATCH_SEND)
+        {
+            m.msg_name = peer_endpoint_.data();
+            m.msg_namelen = socklen_t(peer_endpoint_.size());
+        }
+        else if (direction == BATCH_REFLECT)
+        {
+            endpoint_type & sender = receive_batch_->senders[i];
+            m.msg_name = sender.data();
+            m.msg_namelen = socklen_t(sender.size());
+        }
+        else
+        {
+            endpoint_type & sender = batch.senders[i];
+            m.msg_name = sender.data();
+            m.msg_namelen = socklen_t(sender.capacity());
+            m.msg_control = &batch.controls[i * CONTROL_SIZE];
+            m.msg_controllen = CONTROL_SIZE;
+        }
+    }
+#endif
+}
+
+std::size_t
+UdpSocket::perform_batch(BatchDirection direction,
+                         boost::system::error_code & failure)
+{
+#ifdef __linux__
+    Batch & batch = direction == BATCH_RECEIVE ? *receive_batch_ : *send_batch_;
+
+    int count;
+    do
+        if (direction != BATCH_RECEIVE)
+            count = ::sendmmsg(socket_.native_handle(),
+                               batch.messages.data(), unsigned(batch.size),
+                               MSG_DONTWAIT);
+        else
+            count = ::recvmmsg(socket_.native_handle(),
+                               batch.messages.data(), unsigned(batch.size),
+                               MSG_DONTWAIT, nullptr);
+    while (count < 0 && errno == EINTR);
+
+    if (count < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            failure = ao::error::would_block;
+        else
+            failure = boost::system::error_code{errno,
+                    boost::system::system_category()};
+        return 0;
+    }
+
+    if (direction == BATCH_RECEIVE)
+        for (std::size_t i = 0; i != std::size_t(count); ++i)
+        {
+            auto & datagram = (*batch.datagrams)[i];
+            msghdr & m = batch.messages[i].msg_hdr;
+            datagram = ao::buffer(datagram, batch.messages[i].msg_len);
+            batch.senders[i].resize(m.msg_namelen);
+
+            batch.segment_sizes[i] = 0;
+            for (cmsghdr * c = CMSG_FIRSTHDR(&m); c; c = CMSG_NXTHDR(&m, c))
+                if (c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO)
+                {
+                    int segment_size;
+                    std::memcpy(&segment_size, CMSG_DATA(c),
+                                sizeof(segment_size));
+                    batch.segment_sizes[i] = std::size_t(segment_size);
+                }
+        }
+
+    return std::size_t(count);
+#else
+    failure = ao::error::operation_not_supported;
+    return 0;
+#endif
+}
+
+std::size_t
+UdpSocket::received_segment_size(std::size_t i) const
+{
+#ifdef __linux__
+    return receive_batch_->segment_sizes[i];
+#else
+    return 0;
+#endif
+}
+
+void
+UdpSocket::cancel()
+{
+    boost::system::error_code failure;
+    socket_.cancel(failure);
 }
 
 void
 UdpSocket::close()
 {
+    if (ring_)
+        ring_->unregister_file(file_);
+
     boost::system::error_code failure;
     socket_.close(failure);
 }
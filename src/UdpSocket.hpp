@@ -24,12 +24,18 @@
 
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <vector>
+
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <boost/system/error_code.hpp>
 
 #include "SessionConfiguration.hpp"
 #include "Socket.hpp"
+#include "IoUring.hpp"
+#include "KernelTimestamps.hpp"
 
 namespace enyx {
 namespace net_tester {
@@ -40,41 +46,267 @@ public:
     using socket_type = boost::asio::ip::udp::socket;
     using protocol_type = socket_type::protocol_type;
     using endpoint_type = socket_type::endpoint_type;
+    using Datagrams = std::vector<boost::asio::mutable_buffer>;
+    // The datagrams sent may be read-only (e.g. the shared send pattern).
+    using ConstDatagrams = std::vector<boost::asio::const_buffer>;
 
 public:
     explicit
     UdpSocket(boost::asio::io_service & io_service,
               const SessionConfiguration & configuration);
 
+    ~UdpSocket();
+
     template<typename MutableBufferSequence, typename ReadHandler>
     void
     async_receive(const MutableBufferSequence & buffers, ReadHandler handler)
     {
-        socket_.async_receive_from(buffers, discarded_endpoint_, handler);
+        if (ring_)
+            ring_->async_read(file_,
+                              *boost::asio::buffer_sequence_begin(buffers),
+                              false,
+                              std::move(handler));
+        else if (timestamps_)
+            timestamps_->async_receive(
+                    socket_,
+                    *boost::asio::buffer_sequence_begin(buffers),
+                    &sender_endpoint_,
+                    std::move(handler));
+        else
+            socket_.async_receive_from(buffers, sender_endpoint_, handler);
     }
 
     template<typename ConstBufferSequence, typename WriteHandler>
     void
     async_send(const ConstBufferSequence & buffers, WriteHandler handler)
     {
-        socket_.async_send_to(buffers, peer_endpoint_, handler);
+        if (ring_)
+            ring_->async_write(file_,
+                               *boost::asio::buffer_sequence_begin(buffers),
+                               std::move(handler));
+        else if (timestamps_)
+            socket_.async_send_to(buffers, peer_endpoint_,
+                                  timestamps_->wrap_send(std::move(handler)));
+        else
+            socket_.async_send_to(buffers, peer_endpoint_, handler);
+    }
+
+    // Send back to the sender of the last datagram received
+    // with async_receive().
+    template<typename ConstBufferSequence, typename WriteHandler>
+    void
+    async_reflect(const ConstBufferSequence & buffers, WriteHandler handler)
+    {
+        if (timestamps_)
+            socket_.async_send_to(buffers, sender_endpoint_,
+                                  timestamps_->wrap_send(std::move(handler)));
+        else
+            socket_.async_send_to(buffers, sender_endpoint_, handler);
+    }
+
+    // Send the datagrams with a single sendmmsg(), the handler
+    // is invoked with the count of datagrams actually sent.
+    template<typename WriteHandler>
+    void
+    async_send_batch(const ConstDatagrams & datagrams, WriteHandler handler)
+    {
+        prepare_batch(datagrams, nullptr);
+        start_batch(BATCH_SEND, std::move(handler));
+    }
+
+    // Likewise, each datagram being prefixed with the matching header.
+    template<typename WriteHandler>
+    void
+    async_send_batch(const ConstDatagrams & headers,
+                     const ConstDatagrams & datagrams,
+                     WriteHandler handler)
+    {
+        prepare_batch(datagrams, &headers);
+        start_batch(BATCH_SEND, std::move(handler));
     }
 
+    // Send back each datagram to the sender of the matching datagram
+    // of the last received batch.
+    template<typename WriteHandler>
+    void
+    async_reflect_batch(Datagrams & datagrams, WriteHandler handler)
+    {
+        prepare_batch(BATCH_REFLECT, datagrams);
+        start_batch(BATCH_REFLECT, std::move(handler));
+    }
+
+    // Receive up to datagrams.size() datagrams with a single recvmmsg(),
+    // each received datagram buffer is shrunk to the received size.
+    // With GRO, a received datagram may contain several segments.
+    template<typename ReadHandler>
+    void
+    async_receive_batch(Datagrams & datagrams, ReadHandler handler)
+    {
+        prepare_batch(BATCH_RECEIVE, datagrams);
+        start_batch(BATCH_RECEIVE, std::move(handler));
+    }
+
+    // Size of the segments coalesced into the i-th datagram
+    // of the last received batch, 0 when not coalesced.
+    std::size_t
+    received_segment_size(std::size_t i) const;
+
+    // Sender of the last datagram received with async_receive().
+    const endpoint_type &
+    sender_endpoint() const
+    { return sender_endpoint_; }
+
+    // Destination of the datagrams sent, a listening socket
+    // doesn't know it until a peer has been heard from.
+    void
+    set_peer_endpoint(const endpoint_type & endpoint)
+    { peer_endpoint_ = endpoint; }
+
+    // With --timestamping, null otherwise.
+    KernelTimestamps *
+    timestamps()
+    { return timestamps_.get(); }
+
+    // Abort the pending operations.
+    void
+    cancel();
+
     void
     close();
 
 private:
+    // Reflected batches are sent to the senders of the last
+    // received batch.
+    enum BatchDirection { BATCH_SEND, BATCH_RECEIVE, BATCH_REFLECT };
+
+    struct Batch;
+
+    template<typename Handler>
+    class BatchCompletion
+    {
+    public:
+        using allocator_type = boost::asio::associated_allocator_t<Handler>;
+
+    public:
+        BatchCompletion(Handler handler,
+                        const boost::system::error_code & failure,
+                        std::size_t datagrams_count)
+            : handler_(std::move(handler)),
+              failure_(failure),
+              datagrams_count_(datagrams_count)
+        { }
+
+        allocator_type
+        get_allocator() const noexcept
+        {
+            return boost::asio::get_associated_allocator(handler_);
+        }
+
+        void
+        operator()()
+        {
+            handler_(failure_, datagrams_count_);
+        }
+
+    private:
+        Handler handler_;
+        boost::system::error_code failure_;
+        std::size_t datagrams_count_;
+    };
+
+    template<typename Handler>
+    class BatchOperation
+    {
+    public:
+        using allocator_type = boost::asio::associated_allocator_t<Handler>;
+
+    public:
+        BatchOperation(UdpSocket & socket,
+                       BatchDirection direction,
+                       Handler handler)
+            : socket_(socket),
+              direction_(direction),
+              handler_(std::move(handler))
+        { }
+
+        allocator_type
+        get_allocator() const noexcept
+        {
+            return boost::asio::get_associated_allocator(handler_);
+        }
+
+        // Invoked when the socket is ready to perform the batch.
+        void
+        operator()(const boost::system::error_code & failure)
+        {
+            if (failure)
+                handler_(failure, 0);
+            else
+                socket_.start_batch(direction_, std::move(handler_));
+        }
+
+    private:
+        UdpSocket & socket_;
+        BatchDirection direction_;
+        Handler handler_;
+    };
+
+    template<typename Handler>
+    void
+    start_batch(BatchDirection direction, Handler handler)
+    {
+        // Try first to perform the batch without waiting for the reactor.
+        boost::system::error_code failure;
+        std::size_t count = perform_batch(direction, failure);
+
+        if (failure == boost::asio::error::would_block)
+            socket_.async_wait(direction == BATCH_RECEIVE ?
+                                    socket_type::wait_read :
+                                    socket_type::wait_write,
+                               BatchOperation<Handler>{*this, direction,
+                                                       std::move(handler)});
+        else
+            io_service_.post(BatchCompletion<Handler>{std::move(handler),
+                                                      failure, count});
+    }
+
+    // Prepare a BATCH_SEND.
+    void
+    prepare_batch(const ConstDatagrams & datagrams,
+                  const ConstDatagrams * headers);
+
+    // Prepare a BATCH_RECEIVE or a BATCH_REFLECT.
+    void
+    prepare_batch(BatchDirection direction, Datagrams & datagrams);
+
+    template<typename Buffers>
+    void
+    prepare_messages(BatchDirection direction,
+                     const Buffers & datagrams,
+                     const ConstDatagrams * headers);
+
+    std::size_t
+    perform_batch(BatchDirection direction,
+                  boost::system::error_code & failure);
+
     void
     connect(const SessionConfiguration & configuration);
 
     void
-    listen(const SessionConfiguration & configuration,
-           const boost::posix_time::time_duration & timeout);
+    listen(const SessionConfiguration & configuration);
+
+    void
+    setup(const SessionConfiguration & configuration);
 
 private:
     socket_type socket_;
-    endpoint_type discarded_endpoint_;
+    endpoint_type sender_endpoint_;
     endpoint_type peer_endpoint_;
+    IoUring * ring_;
+    IoUring::File file_;
+    std::unique_ptr<Batch> send_batch_;
+    std::unique_ptr<Batch> receive_batch_;
+    std::unique_ptr<KernelTimestamps> timestamps_;
 };
 
 } // namespace net_tester
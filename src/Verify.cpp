@@ -0,0 +1,180 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "Verify.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define NET_TESTER_X86_SIMD
+#   include <immintrin.h>
+#endif
+
+namespace enyx {
+namespace net_tester {
+
+namespace {
+
+std::size_t
+find_mismatch_scalar(const std::uint8_t * data,
+                     std::size_t size,
+                     std::uint8_t first_byte)
+{
+    for (std::size_t i = 0; i != size; ++i)
+        if (data[i] != std::uint8_t(first_byte + i))
+            return i;
+
+    return size;
+}
+
+#ifdef NET_TESTER_X86_SIMD
+
+// Each implementation compares a whole vector against the expected
+// pattern, which is then incremented by the vector width (byte lanes
+// wrap around as the pattern does), and only locates the mismatching
+// byte from the comparison mask.
+
+__attribute__((target("sse2"))) std::size_t
+find_mismatch_sse2(const std::uint8_t * data,
+                   std::size_t size,
+                   std::uint8_t first_byte)
+{
+    __m128i expected = _mm_add_epi8(
+            _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                          8, 9, 10, 11, 12, 13, 14, 15),
+            _mm_set1_epi8(char(first_byte)));
+    __m128i const step = _mm_set1_epi8(16);
+
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i actual = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(data + i));
+        unsigned equal = unsigned(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(actual, expected)));
+        if (equal != 0xffff)
+            return i + unsigned(__builtin_ctz(~equal));
+
+        expected = _mm_add_epi8(expected, step);
+    }
+
+    return i + find_mismatch_scalar(data + i, size - i,
+                                    std::uint8_t(first_byte + i));
+}
+
+__attribute__((target("avx2"))) std::size_t
+find_mismatch_avx2(const std::uint8_t * data,
+                   std::size_t size,
+                   std::uint8_t first_byte)
+{
+    __m256i expected = _mm256_add_epi8(
+            _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                             8, 9, 10, 11, 12, 13, 14, 15,
+                             16, 17, 18, 19, 20, 21, 22, 23,
+                             24, 25, 26, 27, 28, 29, 30, 31),
+            _mm256_set1_epi8(char(first_byte)));
+    __m256i const step = _mm256_set1_epi8(32);
+
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i actual = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(data + i));
+        unsigned equal = unsigned(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(actual, expected)));
+        if (equal != 0xffffffff)
+            return i + unsigned(__builtin_ctz(~equal));
+
+        expected = _mm256_add_epi8(expected, step);
+    }
+
+    return i + find_mismatch_sse2(data + i, size - i,
+                                  std::uint8_t(first_byte + i));
+}
+
+__attribute__((target("avx512f,avx512bw"))) std::size_t
+find_mismatch_avx512(const std::uint8_t * data,
+                     std::size_t size,
+                     std::uint8_t first_byte)
+{
+    alignas(64) std::uint8_t lanes[64];
+    for (unsigned j = 0; j != 64; ++j)
+        lanes[j] = std::uint8_t(first_byte + j);
+
+    __m512i expected = _mm512_load_si512(lanes);
+    __m512i const step = _mm512_set1_epi8(64);
+
+    std::size_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m512i actual = _mm512_loadu_si512(data + i);
+        __mmask64 equal = _mm512_cmpeq_epi8_mask(actual, expected);
+        if (equal != ~__mmask64(0))
+            return i + unsigned(__builtin_ctzll(~equal));
+
+        expected = _mm512_add_epi8(expected, step);
+    }
+
+    return i + find_mismatch_avx2(data + i, size - i,
+                                  std::uint8_t(first_byte + i));
+}
+
+#endif
+
+PatternMismatchFinder
+select_fastest()
+{
+    return get_pattern_verifiers().back().find_mismatch;
+}
+
+} // anonymous namespace
+
+std::vector<PatternVerifier>
+get_pattern_verifiers()
+{
+    std::vector<PatternVerifier> verifiers{{"scalar", &find_mismatch_scalar}};
+
+#ifdef NET_TESTER_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        verifiers.push_back({"sse2", &find_mismatch_sse2});
+    if (__builtin_cpu_supports("avx2"))
+        verifiers.push_back({"avx2", &find_mismatch_avx2});
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        verifiers.push_back({"avx512", &find_mismatch_avx512});
+#endif
+
+    return verifiers;
+}
+
+std::size_t
+find_pattern_mismatch(const std::uint8_t * data,
+                      std::size_t size,
+                      std::uint8_t first_byte)
+{
+    static PatternMismatchFinder const find_mismatch = select_fastest();
+    return find_mismatch(data, size, first_byte);
+}
+
+} // namespace net_tester
+} // namespace enyx
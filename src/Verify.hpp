@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace enyx {
+namespace net_tester {
+
+// Return the offset of the first byte of data not matching the
+// pattern data[i] == uint8_t(first_byte + i), or size when all match.
+using PatternMismatchFinder = std::size_t (*)(const std::uint8_t * data,
+                                              std::size_t size,
+                                              std::uint8_t first_byte);
+
+struct PatternVerifier
+{
+    const char * name;
+    PatternMismatchFinder find_mismatch;
+};
+
+// The implementations supported by the running CPU, fastest last.
+std::vector<PatternVerifier>
+get_pattern_verifiers();
+
+// Find the first mismatch with the fastest supported implementation,
+// selected once at startup.
+std::size_t
+find_pattern_mismatch(const std::uint8_t * data,
+                      std::size_t size,
+                      std::uint8_t first_byte);
+
+} // namespace net_tester
+} // namespace enyx
@@ -0,0 +1,116 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 EnyxSA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+// Measure the payload verification cost of each instruction set
+// supported by the running CPU, in bytes per cycle.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <x86intrin.h>
+#   define BENCH_HAS_RDTSC
+#endif
+
+#include "Verify.hpp"
+
+namespace {
+
+namespace nt = enyx::net_tester;
+
+std::uint64_t
+read_cycles()
+{
+#ifdef BENCH_HAS_RDTSC
+    return __rdtsc();
+#else
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char ** argv)
+{
+    // Default to a buffer fitting in L2, as received data usually is.
+    std::size_t const size = argc > 1 ? std::strtoull(argv[1], nullptr, 0)
+                                      : 128 * 1024;
+    std::size_t const iterations = argc > 2 ? std::strtoull(argv[2], nullptr, 0)
+                                            : 2000;
+
+    std::vector<std::uint8_t> buffer(size + 1);
+    for (std::size_t i = 0; i != buffer.size(); ++i)
+        buffer[i] = std::uint8_t(i + 7);
+
+    // Start unaligned as a payload following a header would.
+    const std::uint8_t * data = buffer.data() + 1;
+
+    std::cout << "buffer size " << size << " bytes, "
+              << iterations << " iterations" << std::endl;
+
+    int result = EXIT_SUCCESS;
+    for (auto const& verifier : nt::get_pattern_verifiers())
+    {
+        // Check the mismatch is located before measuring.
+        std::size_t const corrupted = size / 2 + 3;
+        buffer[corrupted + 1] ^= 0xff;
+        bool const is_correct =
+                verifier.find_mismatch(data, size, 8) == corrupted;
+        buffer[corrupted + 1] ^= 0xff;
+
+        if (! is_correct ||
+                verifier.find_mismatch(data, size, 8) != size)
+        {
+            std::cout << std::setw(8) << verifier.name
+                      << ": wrong mismatch offset" << std::endl;
+            result = EXIT_FAILURE;
+            continue;
+        }
+
+        std::size_t sink = 0;
+        std::uint64_t const start = read_cycles();
+        for (std::size_t i = 0; i != iterations; ++i)
+            sink += verifier.find_mismatch(data, size, 8);
+        std::uint64_t const cycles = read_cycles() - start;
+
+        std::cout << std::setw(8) << verifier.name << ": "
+                  << std::fixed << std::setprecision(2)
+                  << double(sink) / double(cycles)
+#ifdef BENCH_HAS_RDTSC
+                  << " bytes/cycle"
+#else
+                  << " bytes/ns"
+#endif
+                  << std::endl;
+    }
+
+    return result;
+}
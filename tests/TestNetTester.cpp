@@ -1,16 +1,30 @@
 #define BOOST_TEST_MODULE NetTester
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdint>
+#include <functional>
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#   include <netinet/in.h>
+#   include <signal.h>
+#   include <sys/socket.h>
+#   include <unistd.h>
+#endif
 
 #include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/process.hpp>
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
 
 namespace p = boost::process;
+namespace fs = boost::filesystem;
 namespace ip = boost::asio::ip;
 
 static constexpr std::size_t PAYLOAD_SIZE = 1024 * 1024;
@@ -324,6 +338,26 @@ BOOST_AUTO_TEST_CASE(VerifyAll)
     wait_for_net_tester();
 }
 
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(IoUringEngine)
+{
+    start_net_tester_server(PAYLOAD_SIZE, "--verify=all --engine=io_uring");
+
+    io_service_.run();
+
+    wait_for_net_tester();
+}
+
+BOOST_AUTO_TEST_CASE(ZeroCopy)
+{
+    start_net_tester_server(PAYLOAD_SIZE, "--verify=all --zerocopy");
+
+    io_service_.run();
+
+    wait_for_net_tester();
+}
+#endif
+
 BOOST_AUTO_TEST_CASE(RxOnly)
 {
     start_net_tester_server(PAYLOAD_SIZE,
@@ -364,7 +398,9 @@ BOOST_AUTO_TEST_SUITE_END()
 
 struct UdpFixture
 {
-    enum Direction { TO_NET_TESTER, FROM_NET_TESTER, BOTH };
+    // With ECHOED, the peer sends each datagram and checks that
+    // net-tester echoes it back unchanged before sending the next one.
+    enum Direction { TO_NET_TESTER, FROM_NET_TESTER, BOTH, ECHOED };
 
     UdpFixture()
         : io_service_(),
@@ -375,10 +411,40 @@ struct UdpFixture
           local_endpoint_(ip::address::from_string("127.0.0.1"), 1234),
           net_tester_buffer_(),
           peer_buffer_(65535),
+          peer_sent_buffer_(),
           requested_size_(),
-          direction_()
+          direction_(),
+          on_net_tester_started_()
     { }
 
+    void
+    start_net_tester_server(std::size_t requested_size,
+                            const std::string & args,
+                            std::function<void()> on_started)
+    {
+        requested_size_ = requested_size;
+        on_net_tester_started_ = std::move(on_started);
+
+        std::ofstream{"net-tester-cmd", std::ofstream::trunc}
+                         << " --listen="
+                         << remote_endpoint_.address() << ":"
+                         << remote_endpoint_.port()
+                         << " --protocol=udp"
+                         << " --size=" << requested_size_ << "B"
+                         << " " << args;
+
+        net_tester_ = p::child{NET_TESTER_BINARY_PATH
+                               " --configuration-file=net-tester-cmd",
+                               p::std_in < p::null,
+                               p::std_out > net_tester_server_stdout_,
+                               p::std_err > stderr,
+                               io_service_};
+
+        BOOST_TEST_CHECKPOINT("net-tester server started");
+
+        async_read_net_tester_output();
+    }
+
     void
     start_net_tester_client(std::size_t requested_size,
                        const std::string & args = std::string{})
@@ -418,9 +484,15 @@ struct UdpFixture
         peer_socket_.connect(remote_endpoint_);
 
         if (direction_ == FROM_NET_TESTER)
+        {
+            // A listening source sends to the first peer heard from.
+            peer_socket_.send(boost::asio::buffer(peer_buffer_, 0));
             async_read_rx_peer();
+        }
         else if (direction_ == TO_NET_TESTER)
             async_write_tx_peer();
+        else if (direction_ == ECHOED)
+            async_write_echoed_peer();
         else
             async_read_rxtx_peer();
 
@@ -458,6 +530,10 @@ struct UdpFixture
             if (! line.empty())
                 std::cout << "enyx-net-tester: " << line << std::endl;
 
+            // The peer can't send before the server socket is bound.
+            if (line == "Started." && on_net_tester_started_)
+                on_net_tester_started_();
+
             async_read_net_tester_output();
         }
     }
@@ -534,6 +610,46 @@ struct UdpFixture
             async_write_tx_peer();
     }
 
+    void
+    async_write_echoed_peer()
+    {
+        const std::size_t size = std::min<std::size_t>(1024, requested_size_);
+
+        // Each datagram content differs from the previous one.
+        peer_sent_buffer_.resize(size);
+        for (std::size_t i = 0; i != size; ++i)
+            peer_sent_buffer_[i] = std::uint8_t(requested_size_ + i * 7);
+
+        peer_socket_.async_send(boost::asio::buffer(peer_sent_buffer_),
+                                boost::bind(&UdpFixture::on_peer_echoed_sent, this, _1, _2));
+    }
+
+    void
+    on_peer_echoed_sent(const boost::system::error_code & failure,
+                        std::size_t bytes_sent)
+    {
+        BOOST_REQUIRE_EQUAL(failure, boost::system::error_code{});
+        BOOST_REQUIRE_EQUAL(bytes_sent, peer_sent_buffer_.size());
+
+        peer_socket_.async_receive(boost::asio::buffer(peer_buffer_),
+                                   boost::bind(&UdpFixture::on_peer_echoed_receive, this, _1, _2));
+    }
+
+    void
+    on_peer_echoed_receive(const boost::system::error_code & failure,
+                           std::size_t bytes_received)
+    {
+        BOOST_REQUIRE_EQUAL(failure, boost::system::error_code{});
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(peer_buffer_.begin(),
+                                        peer_buffer_.begin() + bytes_received,
+                                        peer_sent_buffer_.begin(),
+                                        peer_sent_buffer_.end());
+
+        requested_size_ -= bytes_received;
+        if (requested_size_)
+            async_write_echoed_peer();
+    }
+
     boost::asio::io_service io_service_;
     ip::udp::socket peer_socket_;
     p::async_pipe net_tester_server_stdout_;
@@ -542,10 +658,48 @@ struct UdpFixture
     ip::udp::endpoint local_endpoint_;
     boost::asio::streambuf net_tester_buffer_;
     std::vector<std::uint8_t> peer_buffer_;
+    std::vector<std::uint8_t> peer_sent_buffer_;
     std::size_t requested_size_;
     Direction direction_;
+    std::function<void()> on_net_tester_started_;
 };
 
+BOOST_FIXTURE_TEST_SUITE(ServerUdp, UdpFixture)
+
+BOOST_AUTO_TEST_CASE(Sink)
+{
+    start_net_tester_server(32 * 1024,
+                            "--mode=rx --shutdown-policy=receive_complete",
+                            [this] { start_peer_server(TO_NET_TESTER); });
+
+    io_service_.run();
+
+    wait_for_net_tester();
+}
+
+BOOST_AUTO_TEST_CASE(Reflector)
+{
+    start_net_tester_server(32 * 1024, "--mode=both",
+                            [this] { start_peer_server(ECHOED); });
+
+    io_service_.run();
+
+    wait_for_net_tester();
+}
+
+BOOST_AUTO_TEST_CASE(Source)
+{
+    start_net_tester_server(32 * 1024,
+                            "--mode=tx --shutdown-policy=send_complete",
+                            [this] { start_peer_server(FROM_NET_TESTER); });
+
+    io_service_.run();
+
+    wait_for_net_tester();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_FIXTURE_TEST_SUITE(ClientUdp, UdpFixture)
 
 BOOST_AUTO_TEST_CASE(RxTx, * boost::unit_test::disabled())
@@ -559,3 +713,740 @@ BOOST_AUTO_TEST_CASE(RxTx, * boost::unit_test::disabled())
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+// Runs a net-tester server and, once started, a net-tester client
+// connected to it, keeping their output lines to check their statistics.
+struct LoopbackFixture
+{
+    struct NetTester
+    {
+        NetTester(boost::asio::io_service & io_service, const std::string & name)
+            : name(name),
+              configuration_path(fs::temp_directory_path() /
+                                 fs::unique_path("net-tester-%%%%%%%%-" + name)),
+              stdout_pipe(io_service),
+              child(),
+              buffer(),
+              lines()
+        { }
+
+        ~NetTester()
+        {
+            boost::system::error_code failure;
+            fs::remove(configuration_path, failure);
+        }
+
+        std::string name;
+        fs::path configuration_path;
+        p::async_pipe stdout_pipe;
+        p::child child;
+        boost::asio::streambuf buffer;
+        std::vector<std::string> lines;
+    };
+
+    LoopbackFixture()
+        : io_service_(),
+          server_(io_service_, "server"),
+          client_(io_service_, "client"),
+          client_configuration_(),
+          client_args_(),
+          on_client_started_()
+    { }
+
+    // Each configuration holds one session per line, args are
+    // added to both net-tester command lines and client_args to
+    // the client one only.
+    void
+    run(const std::string & server_configuration,
+        const std::string & client_configuration,
+        const std::string & args = std::string{},
+        const std::string & client_args = std::string{})
+    {
+        client_configuration_ = client_configuration;
+        client_args_ = args + " " + client_args;
+
+        start(server_, server_configuration, args);
+
+        io_service_.run();
+
+        // The client isn't started when the server fails early.
+        server_.child.wait();
+        if (client_.child.valid())
+            client_.child.wait();
+    }
+
+    void
+    start(NetTester & net_tester,
+          const std::string & configuration,
+          const std::string & args)
+    {
+        std::string const path = net_tester.configuration_path.string();
+        std::ofstream{path, std::ofstream::trunc} << configuration;
+
+        // Both net-testers may share a single CPU, hence they
+        // mustn't spin waiting for network events.
+        net_tester.child = p::child{NET_TESTER_BINARY_PATH
+                                    " --polling=block --configuration-file=" +
+                                    path + " " + args,
+                                    p::std_in < p::null,
+                                    p::std_out > net_tester.stdout_pipe,
+                                    p::std_err > stderr,
+                                    io_service_};
+
+        async_read_output(net_tester);
+    }
+
+    void
+    async_read_output(NetTester & net_tester)
+    {
+        boost::asio::async_read_until(net_tester.stdout_pipe,
+                                      net_tester.buffer,
+                                      '\n',
+                                      [this, &net_tester]
+                                      (const boost::system::error_code & failure,
+                                       std::size_t) {
+            on_output_receive(net_tester, failure);
+        });
+    }
+
+    void
+    on_output_receive(NetTester & net_tester,
+                      const boost::system::error_code & failure)
+    {
+        if (failure)
+            return;
+
+        std::string line;
+        {
+            std::istream is(&net_tester.buffer);
+            std::getline(is, line);
+        }
+
+        if (! line.empty())
+            std::cout << "enyx-net-tester " << net_tester.name << ": "
+                      << line << std::endl;
+        net_tester.lines.push_back(line);
+
+        if (line == "Started." && &net_tester == &server_)
+            start(client_, client_configuration_, client_args_);
+        else if (line == "Started." && on_client_started_)
+            on_client_started_();
+
+        async_read_output(net_tester);
+    }
+
+    // Return the first line starting with prefix.
+    static std::string
+    find_line(const NetTester & net_tester, const std::string & prefix)
+    {
+        for (auto const& line : net_tester.lines)
+            if (line.compare(0, prefix.size(), prefix) == 0)
+                return line;
+
+        BOOST_FAIL("no " << net_tester.name << " line starts with " << prefix);
+        return std::string{};
+    }
+
+    // Return the exact bits count of a statistics line, e.g.
+    // 1048576000 from "send_bandwidth: 1000.0Mibit(1048576000bit)/s".
+    static std::uint64_t
+    get_bits_count(const std::string & line)
+    {
+        auto const begin = line.find('(');
+        BOOST_REQUIRE_NE(begin, std::string::npos);
+        return std::stoull(line.substr(begin + 1));
+    }
+
+    static std::size_t
+    count_lines(const NetTester & net_tester, const std::string & prefix)
+    {
+        std::size_t count = 0;
+        for (auto const& line : net_tester.lines)
+            if (line.compare(0, prefix.size(), prefix) == 0)
+                ++ count;
+        return count;
+    }
+
+    static std::size_t
+    count_lines_containing(const NetTester & net_tester,
+                           const std::string & text)
+    {
+        std::size_t count = 0;
+        for (auto const& line : net_tester.lines)
+            if (line.find(text) != std::string::npos)
+                ++ count;
+        return count;
+    }
+
+    boost::asio::io_service io_service_;
+    NetTester server_;
+    NetTester client_;
+    std::string client_configuration_;
+    std::string client_args_;
+    // Invoked once the client is started, if set.
+    std::function<void()> on_client_started_;
+};
+
+#ifdef __linux__
+// Whether the kernel segments UDP datagrams (i.e. UDP_SEGMENT, Linux 4.18).
+static bool
+is_udp_segmentation_supported()
+{
+    int const descriptor = ::socket(AF_INET, SOCK_DGRAM, 0);
+    int const segment_size = 1024;
+    bool const is_supported = ::setsockopt(descriptor, IPPROTO_UDP,
+                                           103 /* UDP_SEGMENT */,
+                                           &segment_size,
+                                           sizeof(segment_size)) == 0;
+    ::close(descriptor);
+    return is_supported;
+}
+#endif
+
+BOOST_FIXTURE_TEST_SUITE(Loopback, LoopbackFixture)
+
+BOOST_AUTO_TEST_CASE(Summary)
+{
+    // The slowest session is also the only one below the median.
+    run("--listen=127.0.0.1:1240-1243 --size=256KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1240 --size=256KiB --mode=tx --tx-bandwidth=8MB\n"
+        "--connect=127.0.0.1:1241-1243 --size=256KiB --mode=tx"
+        " --tx-bandwidth=64MB",
+        "--slowest-sessions=1");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    for (auto const* net_tester : {&server_, &client_})
+    {
+        BOOST_REQUIRE_EQUAL(find_line(*net_tester, "sessions_count:"),
+                            "sessions_count: 4");
+        BOOST_REQUIRE_EQUAL(count_lines(*net_tester, "slowest_session "), 1);
+        find_line(*net_tester, "slowest_session 0: 127.0.0.1:1240,");
+    }
+
+    // Only the configured direction of the sessions is accounted.
+    find_line(server_, "session_receive_bandwidths: min ");
+    BOOST_REQUIRE_EQUAL(count_lines(server_, "session_send_bandwidths:"), 0);
+    find_line(client_, "session_send_bandwidths: min ");
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "session_receive_bandwidths:"), 0);
+
+    // One of the 4 sessions gets an eighth of the others bandwidth.
+    auto const fairness = find_line(client_, "send_fairness_index: ");
+    double const index = std::stod(fairness.substr(fairness.find(' ') + 1));
+    BOOST_REQUIRE_LT(index, 0.95);
+    BOOST_REQUIRE_GT(index, 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(ListenerReportInterval)
+{
+    run("--listen=127.0.0.1:1250 --connections=2 --size=512KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1250 --size=512KiB --mode=tx --tx-bandwidth=16MB\n"
+        "--connect=127.0.0.1:1250 --size=512KiB --mode=tx --tx-bandwidth=16MB",
+        "--report-interval=00:00:00.010");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // The accepted connections are reported along the sessions.
+    BOOST_REQUIRE_GT(count_lines_containing(server_,
+                             " listener: 0 connection: 0 (127.0.0.1:1250)"), 0);
+    BOOST_REQUIRE_GT(count_lines_containing(server_,
+                             " listener: 0 connection: 1 (127.0.0.1:1250)"), 0);
+    BOOST_REQUIRE_GT(count_lines_containing(client_, " session: 1 "), 0);
+    BOOST_REQUIRE_EQUAL(find_line(server_, "connections:"), "connections: 2");
+}
+
+BOOST_AUTO_TEST_CASE(ListenerTimeout)
+{
+    // The second connection is never opened.
+    run("--listen=127.0.0.1:1271 --connections=2 --size=64KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer --duration-margin=00:00:00",
+        "--connect=127.0.0.1:1271 --size=64KiB --mode=tx");
+
+    BOOST_REQUIRE_NE(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    BOOST_REQUIRE_EQUAL(find_line(server_, "connections:"), "connections: 1");
+    BOOST_REQUIRE_EQUAL(count_lines(server_, "status: system:" +
+                                             std::to_string(ETIMEDOUT)), 1);
+}
+
+BOOST_AUTO_TEST_CASE(PingPong)
+{
+    run("--listen=127.0.0.1:1251 --size=64KiB --workload=pong"
+        " --size-per-message=256B",
+        "--connect=127.0.0.1:1251 --size=64KiB --workload=ping"
+        " --size-per-message=256B --verify=all");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // Each message is a round trip.
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "round_trip_times: count 256,"),
+                        1);
+    find_line(client_, "transaction_rate: ");
+}
+
+BOOST_AUTO_TEST_CASE(LongPingPong)
+{
+    // The round trips last longer than the timeout the bandwidth
+    // would give to such a size.
+    run("--listen=127.0.0.1:1270 --size=3MiB --workload=pong"
+        " --size-per-message=64B --duration-margin=00:00:00",
+        "--connect=127.0.0.1:1270 --size=3MiB --workload=ping"
+        " --size-per-message=64B --duration-margin=00:00:00");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "round_trip_times: count 49152,"),
+                        1);
+}
+
+BOOST_AUTO_TEST_CASE(UdpBatch)
+{
+    // The datagrams cut at the slices boundaries make partial batches.
+    run("--listen=127.0.0.1:1272 --protocol=udp --size=300KiB --mode=rx"
+        " --max-datagram-size=1KiB --batch-size=16 --verify=all"
+        " --shutdown-policy=receive_complete",
+        "--connect=127.0.0.1:1272 --protocol=udp --size=300KiB --mode=tx"
+        " --max-datagram-size=1KiB --batch-size=16 --tx-bandwidth=32MB");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    BOOST_REQUIRE_EQUAL(find_line(client_, "sent_bytes_count: "),
+                        "sent_bytes_count: 2.3Mibit(2457600bit)");
+    BOOST_REQUIRE_EQUAL(find_line(server_, "received_bytes_count: "),
+                        "received_bytes_count: 2.3Mibit(2457600bit)");
+    auto const sent = find_line(client_, "sent_datagrams_count: ");
+    BOOST_REQUIRE_EQUAL(find_line(server_, "received_datagrams_count: "),
+                        "received_" + sent.substr(sent.find('_') + 1));
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(UdpOffload)
+{
+    if (! is_udp_segmentation_supported())
+    {
+        BOOST_TEST_MESSAGE("UDP_SEGMENT isn't supported, skipped");
+        return;
+    }
+
+    // Each slice is a single send of 63 segments of 1KiB, the most
+    // below 65507B, the last send being the remaining 16 segments.
+    run("--listen=127.0.0.1:1273 --protocol=udp --size=1MiB --mode=rx"
+        " --max-datagram-size=1KiB --offload=gro --verify=all"
+        " --shutdown-policy=receive_complete",
+        "--connect=127.0.0.1:1273 --protocol=udp --size=1MiB --mode=tx"
+        " --max-datagram-size=1KiB --offload=gso --tx-bandwidth=64512kB");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    BOOST_REQUIRE_EQUAL(find_line(client_, "sent_datagrams_count: "),
+                        "sent_datagrams_count: 1024");
+    BOOST_REQUIRE_EQUAL(find_line(client_, "send_segments_counts: "),
+                        "send_segments_counts: mean 60.2, 16-31: 1, 32-63: 16");
+    BOOST_REQUIRE_EQUAL(find_line(server_, "received_bytes_count: "),
+                        "received_bytes_count: 8.0Mibit(8388608bit)");
+    BOOST_REQUIRE_EQUAL(find_line(server_, "received_datagrams_count: "),
+                        "received_datagrams_count: 1024");
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(UdpSequenceHeader)
+{
+    run("--listen=127.0.0.1:1252 --protocol=udp --size=256KiB --mode=rx"
+        " --max-datagram-size=1KiB --sequence-header"
+        " --shutdown-policy=receive_complete",
+        "--connect=127.0.0.1:1252 --protocol=udp --size=256KiB --mode=tx"
+        " --max-datagram-size=1KiB --sequence-header --tx-bandwidth=32MB");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // Loopback neither loses nor reorders at that bandwidth.
+    BOOST_REQUIRE_EQUAL(find_line(server_, "received_sequences: "),
+                        "received_sequences: lost 0, reordered 0, "
+                        "duplicated 0, late 0, foreign 0");
+    auto const sent = find_line(client_, "sent_datagrams_count: ");
+    BOOST_REQUIRE_EQUAL(find_line(server_, "received_datagrams_count: "),
+                        "received_" + sent.substr(sent.find('_') + 1));
+}
+
+BOOST_AUTO_TEST_CASE(EndpointRanges)
+{
+    // Each address and port of the ranges is a distinct session.
+    run("--listen=127.0.0.1-2:1253-1254 --size=64KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:0:127.0.0.1-2:1253-1254 --size=64KiB --mode=tx");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    for (auto const* net_tester : {&server_, &client_})
+    {
+        BOOST_REQUIRE_EQUAL(find_line(*net_tester, "sessions_count:"),
+                            "sessions_count: 4");
+        BOOST_REQUIRE_EQUAL(count_lines(*net_tester, "status: system:0"), 4);
+    }
+
+    for (auto const* endpoint : {"127.0.0.1:1253,", "127.0.0.1:1254,",
+                                 "127.0.0.2:1253,", "127.0.0.2:1254,"})
+        BOOST_REQUIRE_EQUAL(count_lines_containing(server_, endpoint), 1);
+}
+
+BOOST_AUTO_TEST_CASE(OversizedEndpointRange)
+{
+    // The sessions of 2M endpoints aren't created.
+    run("--connect=127.0.0.1:0:127.0.0.1-32:1-65535 --size=64KiB --mode=tx",
+        "");
+
+    BOOST_REQUIRE_NE(0, server_.child.exit_code());
+    BOOST_REQUIRE(! client_.child.valid());
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(Burst)
+{
+    // The client is stopped for 50ms during its transfer.
+    boost::asio::steady_timer timer{io_service_};
+    on_client_started_ = [this, &timer] {
+        timer.expires_from_now(std::chrono::milliseconds(50));
+        timer.async_wait([this, &timer](const boost::system::error_code &) {
+            ::kill(client_.child.id(), SIGSTOP);
+            timer.expires_from_now(std::chrono::milliseconds(50));
+            timer.async_wait([this](const boost::system::error_code &) {
+                ::kill(client_.child.id(), SIGCONT);
+            });
+        });
+    };
+
+    run("--listen=127.0.0.1:1255 --size=2MiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1255 --size=2MiB --mode=tx --tx-bandwidth=8MB"
+        " --burst=64KiB");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    BOOST_REQUIRE_EQUAL(find_line(client_, "send_target_bandwidth: "),
+                        "send_target_bandwidth: "
+                        "61.0Mibit(64000000bit)/s");
+
+    // Once resumed, the first slice sends the whole burst credit
+    // rather than the 400KB of the slices missed meanwhile, along
+    // with at most 2 regular slices of 8000B in the same period.
+    std::uint64_t const burst_bits_count = 64 * 1024 * 8;
+    auto const peak = get_bits_count(find_line(client_,
+                                               "send_peak_bandwidth: "));
+    BOOST_REQUIRE_GE(peak, burst_bits_count * 1000);
+    BOOST_REQUIRE_LE(peak, (burst_bits_count + 2 * 8000 * 8) * 1000);
+
+    // The missed slices aren't caught up past the burst.
+    auto const bandwidth = get_bits_count(find_line(client_,
+                                                    "send_bandwidth: "));
+    BOOST_REQUIRE_LE(bandwidth, 64000000U);
+    BOOST_REQUIRE_GE(bandwidth, 64000000U / 2);
+}
+#endif
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(KernelPacing)
+{
+    run("--listen=127.0.0.1:1256 --size=256KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1256 --size=256KiB --mode=tx --tx-bandwidth=16MB"
+        " --pacing=kernel");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    find_line(client_, "send_peak_bandwidth: ");
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(TxRate)
+{
+    run("--listen=127.0.0.1:1257 --protocol=udp --size=64KiB --mode=rx"
+        " --max-datagram-size=1KiB --shutdown-policy=receive_complete",
+        "--connect=127.0.0.1:1257 --protocol=udp --size=64KiB --mode=tx"
+        " --max-datagram-size=1KiB --tx-rate=2000");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    BOOST_REQUIRE_EQUAL(find_line(client_, "sent_datagrams_count: "),
+                        "sent_datagrams_count: 64");
+    BOOST_REQUIRE_EQUAL(find_line(client_, "send_target_datagram_rate: "),
+                        "send_target_datagram_rate: 2000/s");
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "sent_datagram_gaps: count 63,"),
+                        1);
+
+    // The rate is only ever late, never ahead of the target.
+    auto const rate = find_line(client_, "send_datagram_rate: ");
+    BOOST_REQUIRE_LE(std::stoul(rate.substr(rate.find(' ') + 1)), 2500);
+}
+
+BOOST_AUTO_TEST_CASE(OnOffArrival)
+{
+    run("--listen=127.0.0.1:1258 --size=256KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1258 --size=256KiB --mode=tx --tx-bandwidth=32MB"
+        " --arrival=on-off --arrival-burst=32KiB --arrival-gap=00:00:00.001");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // The transfer is split into bursts of the requested size.
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "sent_burst_sizes: count 8, "
+                                    "min 32768B, p50 32768B"), 1);
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "sent_burst_intervals: count 7,"),
+                        1);
+}
+
+BOOST_AUTO_TEST_CASE(TxSchedule)
+{
+    run("--listen=127.0.0.1:1259 --size=512KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1259 --size=512KiB --mode=tx"
+        " --tx-schedule=0:8MB,0.05:32MB",
+        "--report-interval=00:00:00.010");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // The offered bandwidth ramps up over the intervals.
+    std::vector<std::string> targets;
+    for (auto const& line : client_.lines)
+    {
+        auto const target = line.find(" send_target_bandwidth: ");
+        if (line.compare(0, 9, "interval:") == 0 &&
+                target != std::string::npos)
+            targets.push_back(line.substr(target,
+                                          line.find(' ', target + 24) - target));
+    }
+    BOOST_REQUIRE_GE(targets.size(), 2);
+    BOOST_REQUIRE_NE(targets.front(), targets.back());
+}
+
+BOOST_AUTO_TEST_CASE(InvalidTxSchedule)
+{
+    // The configuration is rejected before any session starts.
+    run("--connect=127.0.0.1:1259 --size=512KiB --mode=tx"
+        " --tx-schedule=0:8MB,x", "");
+
+    BOOST_REQUIRE_NE(0, server_.child.exit_code());
+    BOOST_REQUIRE(! client_.child.valid());
+}
+
+BOOST_AUTO_TEST_CASE(Churn)
+{
+    run("--listen=127.0.0.1:1260 --connections=10 --size=64B --workload=pong"
+        " --size-per-message=64B",
+        "--connect=127.0.0.1:1260 --connections=10 --workload=churn"
+        " --size-per-message=64B --churn-concurrency=2",
+        "", "--output-format=json --output-file=net-tester-results.json");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    BOOST_REQUIRE_EQUAL(find_line(client_, "connections: "), "connections: 10");
+    BOOST_REQUIRE_EQUAL(find_line(client_, "connect_failures_count: "),
+                        "connect_failures_count: 0");
+    BOOST_REQUIRE_EQUAL(find_line(client_, "timeouts_count: "),
+                        "timeouts_count: 0");
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "round_trip_times: count 10,"),
+                        1);
+
+    // The churn transactions are part of the results total.
+    std::ifstream results{"net-tester-results.json"};
+    std::string line;
+    std::size_t churns_count = 0;
+    while (std::getline(results, line))
+        if (line.find("\"kind\": \"churn\"") != std::string::npos ||
+                line.find("\"kind\": \"total\"") != std::string::npos)
+        {
+            BOOST_REQUIRE_NE(line.find("\"round_trip_times_count\": 10,"),
+                             std::string::npos);
+            ++ churns_count;
+        }
+    BOOST_REQUIRE_EQUAL(churns_count, 2);
+}
+
+BOOST_AUTO_TEST_CASE(ChurnTimeout)
+{
+    // The stream server never answers the churn message.
+    run("--listen=127.0.0.1:1261 --connections=1 --size=1MiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1261 --connections=1 --workload=churn"
+        " --size-per-message=64B --churn-timeout=00:00:00.050");
+
+    BOOST_REQUIRE_NE(0, client_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(find_line(client_, "timeouts_count: "),
+                        "timeouts_count: 1");
+    BOOST_REQUIRE_EQUAL(find_line(client_, "status: "),
+                        "status: system:" + std::to_string(ETIMEDOUT));
+}
+
+BOOST_AUTO_TEST_CASE(PipelinedPingResponseSize)
+{
+    // 128 messages of 256B, each answered by 16B.
+    run("--listen=127.0.0.1:1262 --size=32KiB --workload=pong"
+        " --size-per-message=256B --response-size=16B",
+        "--connect=127.0.0.1:1262 --size=32KiB --workload=ping"
+        " --size-per-message=256B --response-size=16B --pipeline-depth=4");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "round_trip_times: count 128,"),
+                        1);
+    BOOST_REQUIRE_EQUAL(find_line(client_, "received_bytes_count: "),
+                        "received_bytes_count: 16.0Kibit(16384bit)");
+    BOOST_REQUIRE_EQUAL(find_line(server_, "sent_bytes_count: "),
+                        "sent_bytes_count: 16.0Kibit(16384bit)");
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(SoftwareTimestamping)
+{
+    run("--listen=127.0.0.1:1263 --size=256KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer --timestamping=software",
+        "--connect=127.0.0.1:1263 --size=256KiB --mode=tx"
+        " --timestamping=software");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // Without hardware timestamps, the wire isn't reached.
+    find_line(client_, "send_user_to_qdisc_times: count ");
+    find_line(client_, "send_qdisc_to_driver_times: count ");
+    BOOST_REQUIRE_EQUAL(count_lines(client_, "send_driver_to_wire_times:"), 0);
+    find_line(server_, "receive_driver_to_user_times: count ");
+    BOOST_REQUIRE_EQUAL(count_lines(server_, "receive_wire_to_driver_times:"),
+                        0);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(JsonOutput)
+{
+    run("--listen=127.0.0.1:1264-1265 --size=256KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1264-1265 --size=256KiB --mode=tx",
+        "", "--output-format=json --output-file=net-tester-results.json");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // One record per line, with exact bytes counts.
+    std::ifstream results{"net-tester-results.json"};
+    std::vector<std::string> records;
+    for (std::string line; std::getline(results, line); )
+        records.push_back(line);
+
+    BOOST_REQUIRE_EQUAL(records.front(), "[");
+    BOOST_REQUIRE_EQUAL(records.back(), "]");
+    std::size_t sessions_count = 0, totals_count = 0;
+    for (auto const& record : records)
+        if (record.find("{\"kind\": \"session\", ") != std::string::npos)
+        {
+            BOOST_REQUIRE_NE(record.find("\"sent_bytes_count\": 262144,"),
+                             std::string::npos);
+            ++ sessions_count;
+        }
+        else if (record.find("{\"kind\": \"total\", ") != std::string::npos)
+        {
+            BOOST_REQUIRE_NE(record.find("\"sent_bytes_count\": 524288,"),
+                             std::string::npos);
+            ++ totals_count;
+        }
+    BOOST_REQUIRE_EQUAL(sessions_count, 2);
+    BOOST_REQUIRE_EQUAL(totals_count, 1);
+}
+
+BOOST_AUTO_TEST_CASE(CsvOutput)
+{
+    run("--listen=127.0.0.1:1266 --size=256KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1266 --size=256KiB --mode=tx",
+        "", "--output-format=csv --output-file=net-tester-results.csv");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    auto const split = [](const std::string & line) {
+        std::vector<std::string> fields;
+        std::istringstream s{line};
+        for (std::string field; std::getline(s, field, ','); )
+            fields.push_back(field);
+        return fields;
+    };
+
+    // The header is the union of the records metrics.
+    std::ifstream results{"net-tester-results.csv"};
+    std::string line;
+    BOOST_REQUIRE(std::getline(results, line));
+    auto const columns = split(line);
+    auto const column = std::find(columns.begin(), columns.end(),
+                                  "sent_bytes_count") - columns.begin();
+    BOOST_REQUIRE_EQUAL(columns.at(0), "kind");
+    BOOST_REQUIRE_LT(std::size_t(column), columns.size());
+
+    std::vector<std::string> kinds;
+    while (std::getline(results, line))
+    {
+        auto const fields = split(line);
+        kinds.push_back(fields.at(0));
+        if (kinds.back() == "session" || kinds.back() == "total")
+            BOOST_REQUIRE_EQUAL(fields.at(column), "262144");
+    }
+    BOOST_REQUIRE_EQUAL(std::count(kinds.begin(), kinds.end(), "session"), 1);
+    BOOST_REQUIRE_EQUAL(std::count(kinds.begin(), kinds.end(), "total"), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ThreadCpuUsage)
+{
+    run("--listen=127.0.0.1:1267-1268 --size=1MiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1267-1268 --size=1MiB --mode=tx");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // The bytes of both sessions are accounted to the single thread.
+    for (auto const* net_tester : {&server_, &client_})
+    {
+        auto const usage = find_line(*net_tester, "thread 0 busy_ratio: ");
+        BOOST_REQUIRE_NE(usage.find(", transferred_bytes_count: "
+                                    "16.0Mibit(16777216bit)"),
+                         std::string::npos);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PerfCounters)
+{
+    run("--listen=127.0.0.1:1269 --size=256KiB --mode=rx"
+        " --shutdown-policy=wait_for_peer",
+        "--connect=127.0.0.1:1269 --size=256KiB --mode=tx",
+        "--perf-counters");
+
+    BOOST_REQUIRE_EQUAL(0, server_.child.exit_code());
+    BOOST_REQUIRE_EQUAL(0, client_.child.exit_code());
+
+    // The events available depend on the host, or are unavailable
+    // altogether out of Linux.
+    auto const counts = find_line(client_, "thread 0 perf_counters: ");
+#ifdef __linux__
+    if (counts != "thread 0 perf_counters: unavailable")
+        BOOST_REQUIRE_NE(counts.find("context_switches: "), std::string::npos);
+#else
+    BOOST_REQUIRE_EQUAL(counts, "thread 0 perf_counters: unavailable");
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE_END()
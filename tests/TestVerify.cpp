@@ -0,0 +1,71 @@
+#define BOOST_TEST_MODULE Verify
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Verify.hpp"
+
+namespace nt = enyx::net_tester;
+
+namespace {
+
+// Check each implementation finds the same mismatch as the scalar one
+// in data[0, size), data being unaligned by misalignment bytes.
+void
+check_verifiers(std::size_t misalignment,
+                std::size_t size,
+                std::uint8_t first_byte,
+                std::size_t mismatch)
+{
+    std::vector<std::uint8_t> buffer(misalignment + size);
+    std::uint8_t * data = buffer.data() + misalignment;
+    for (std::size_t i = 0; i != size; ++i)
+        data[i] = std::uint8_t(first_byte + i);
+    if (mismatch < size)
+        data[mismatch] ^= 0x80;
+
+    auto const verifiers = nt::get_pattern_verifiers();
+    std::size_t const expected = verifiers.front().find_mismatch(data, size,
+                                                                 first_byte);
+    BOOST_REQUIRE_EQUAL(expected, std::min(mismatch, size));
+
+    for (auto const& verifier : verifiers)
+        BOOST_CHECK_MESSAGE(verifier.find_mismatch(data, size, first_byte) ==
+                                    expected,
+                            verifier.name << " misses the mismatch at "
+                                          << mismatch << " of " << size
+                                          << " bytes, misaligned by "
+                                          << misalignment);
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(ScalarIsFirst)
+{
+    BOOST_REQUIRE_EQUAL(nt::get_pattern_verifiers().front().name,
+                        std::string{"scalar"});
+}
+
+BOOST_AUTO_TEST_CASE(EveryOffset)
+{
+    // Across the 16, 32 and 64 bytes vectors and their scalar tail.
+    for (std::size_t size : {1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127,
+                             128, 129, 200})
+        for (std::size_t mismatch = 0; mismatch <= size; ++mismatch)
+            check_verifiers(0, size, 0, mismatch);
+}
+
+BOOST_AUTO_TEST_CASE(StartMiddleTail)
+{
+    // The pattern wraps around 255 within the vectors.
+    for (std::size_t misalignment = 0; misalignment != 64; ++misalignment)
+        for (std::size_t size : {0, 100, 4096, 4096 + 71})
+            for (unsigned first_byte : {0, 7, 250})
+                for (std::size_t mismatch : {std::size_t(0), size / 2,
+                                             size - 1, size})
+                    check_verifiers(misalignment, size,
+                                    std::uint8_t(first_byte), mismatch);
+}